@@ -56,6 +56,135 @@ for frag_file in samples/syntax_analyzer/*.decaf; do
     fi
 done
 
+# Run the syntax analyzer tests again, printing the AST from its flat form
+for frag_file in samples/syntax_analyzer/*.decaf; do
+    base_name=$(basename "$frag_file" .decaf)
+    out_file="samples/syntax_analyzer/${base_name}.out"
+    
+    echo "Testing $frag_file with --flatAST..."
+    
+    # Run the program and capture output
+    ./workdir/decaf-22-compiler "$frag_file" "--flatAST" > "temp.out"
+    
+    # Compare with expected output
+    if diff -w "temp.out" "$out_file" > /dev/null; then
+        echo "✓ Test passed: $base_name (flat)"
+    else
+        echo "✗ Test failed: $base_name (flat)"
+        echo "Differences found:"
+        diff -w "temp.out" "$out_file"
+        failed_tests+=("$frag_file (flat)")
+    fi
+done
+
+# Run the syntax analyzer tests again, saving the AST to a file and then
+# printing it from there. An input with syntax errors saves nothing.
+for frag_file in samples/syntax_analyzer/*.decaf; do
+    base_name=$(basename "$frag_file" .decaf)
+    out_file="samples/syntax_analyzer/${base_name}.out"
+    
+    echo "Testing $frag_file with --saveAST and --loadAST..."
+    
+    # Run the program and capture output
+    rm -f "temp.ast"
+    ./workdir/decaf-22-compiler "$frag_file" "--saveAST" "temp.ast" > "temp.out"
+    if [ -f "temp.ast" ]; then
+        ./workdir/decaf-22-compiler "temp.ast" "--loadAST" > "temp.out"
+    fi
+    
+    # Compare with expected output
+    if diff -w "temp.out" "$out_file" > /dev/null; then
+        echo "✓ Test passed: $base_name (saved)"
+    else
+        echo "✗ Test failed: $base_name (saved)"
+        echo "Differences found:"
+        diff -w "temp.out" "$out_file"
+        failed_tests+=("$frag_file (saved)")
+    fi
+done
+
+# Run semantic analyzer tests. The reference outputs end in varying
+# numbers of blank lines, hence -B.
+for frag_file in samples/semantic_analyzer/bad*.decaf; do
+    base_name=$(basename "$frag_file" .decaf)
+    out_file="samples/semantic_analyzer/${base_name}.out"
+    
+    echo "Testing $frag_file..."
+    
+    # Run the program and capture output
+    ./workdir/decaf-22-compiler "$frag_file" "--check" > "temp.out"
+    
+    # Compare with expected output
+    if diff -wB "temp.out" "$out_file" > /dev/null; then
+        echo "✓ Test passed: $base_name"
+    else
+        echo "✗ Test failed: $base_name"
+        echo "Differences found:"
+        diff -wB "temp.out" "$out_file"
+        failed_tests+=("$frag_file")
+    fi
+done
+
+# Run code generation tests. Where the reference is an assembly listing
+# the TAC in its comments is compared, otherwise the output itself.
+for frag_file in samples/semantic_analyzer/t*.decaf; do
+    base_name=$(basename "$frag_file" .decaf)
+    asm_file="samples/semantic_analyzer/${base_name}.s"
+    out_file="samples/semantic_analyzer/${base_name}.out"
+    
+    echo "Testing $frag_file..."
+    
+    # Run the program and capture output
+    ./workdir/decaf-22-compiler "$frag_file" "--tac" > "temp.out"
+    
+    if [ -f "$asm_file" ]; then
+        sed -n -e 's/^  \([A-Za-z_][A-Za-z0-9_]*\):$/\1:/p' -e 's/^\t# /\t/p' "$asm_file" |
+            grep -v "standard Decaf preamble\|(below handles" > "temp.expected"
+    else
+        cp "$out_file" "temp.expected"
+    fi
+    
+    # Compare with expected output
+    if diff -wB "temp.out" "temp.expected" > /dev/null; then
+        echo "✓ Test passed: $base_name"
+    else
+        echo "✗ Test failed: $base_name"
+        echo "Differences found:"
+        diff -wB "temp.out" "temp.expected"
+        failed_tests+=("$frag_file")
+    fi
+done
+
+# Run the syntax and semantic analyzer tests through a parse cache, once
+# to fill it and once more to replay from it
+cache_dir=$(mktemp -d)
+for frag_file in samples/syntax_analyzer/*.decaf samples/semantic_analyzer/bad*.decaf; do
+    base_name=$(basename "$frag_file" .decaf)
+    out_file="${frag_file%.decaf}.out"
+    mode=""
+    case "$frag_file" in
+        samples/semantic_analyzer/*) mode="--check" ;;
+    esac
+    
+    echo "Testing $frag_file with --cache..."
+    
+    for run in miss hit; do
+        # Run the program and capture output, the cache statistics go to stderr
+        ./workdir/decaf-22-compiler "$frag_file" $mode --cache "$cache_dir" --cacheStats > "temp.out" 2> "temp.stats"
+        
+        # Compare with expected output
+        if diff -wB "temp.out" "$out_file" > /dev/null && grep -q "Cache $run" "temp.stats"; then
+            echo "✓ Test passed: $base_name (cache $run)"
+        else
+            echo "✗ Test failed: $base_name (cache $run)"
+            echo "Differences found:"
+            cat "temp.stats"
+            diff -wB "temp.out" "$out_file"
+            failed_tests+=("$frag_file (cache $run)")
+        fi
+    done
+done
+rm -rf "$cache_dir"
 
 # Print summary of failed tests
 if [ ${#failed_tests[@]} -ne 0 ]; then
@@ -69,4 +198,4 @@ else
 fi
 
 # Cleanup
-rm -f temp.out
\ No newline at end of file
+rm -f temp.out temp.expected temp.stats temp.ast
\ No newline at end of file
@@ -0,0 +1,3 @@
+for (i = 0; i < n; i = i + 1)
+for_each fork
+while format
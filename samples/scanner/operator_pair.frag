@@ -0,0 +1,7 @@
+n <=1
+a==b
+x!=y1
+i>=0&&ok
+done||j<=k
+a<b>c
+a= =b
@@ -3,25 +3,28 @@
 #include <algorithm>
 
 // Helper methods for token handling
-Token ASTBuilder::currentToken() const {
-    if (currentTokenIndex >= tokens.size()) {
-        // Return an EOF token if we've reached the end
-        Token eofToken;
-        eofToken.type = TokenType::T_Unknown;
-        eofToken.text = "EOF";
-        return eofToken;
-    }
-    return tokens[currentTokenIndex];
+const Token& ASTBuilder::currentToken() const {
+    // The stream returns its EOF sentinel once we've reached the end. The
+    // reference stays valid until the next call to nextToken().
+    return tokens.current();
 }
 
 
 void ASTBuilder::nextToken() {
-    if (currentTokenIndex <= tokens.size()) {
-        currentTokenIndex++;
+    if (!tokens.atEnd()) {
+        lastLine = currentToken().line;
+        lastColumn = currentToken().column + currentToken().length - 1;
+        tokens.advance();
+        return;
+    }
+    // Stepping onto the EOF token once is allowed. A production that
+    // wants to go further ran out of input, and is abandoned like any
+    // other that meets an unexpected token.
+    if (!advancedPastEnd) {
+        advancedPastEnd = true;
         return;
     }
-    std::cout << "Throwing exception, reached end of file" << std::endl;
-    throw std::out_of_range("Reached EOF");
+    reportError(currentToken().line, caretUnder(currentToken()));
 }
 
 bool ASTBuilder::match(TokenType type) {
@@ -39,7 +42,7 @@ bool ASTBuilder::check(TokenType type) const {
 void ASTBuilder::consume(TokenType type) {
     if (check(type)) {
         if(verbose) {
-            std::cout << "Consumed " << currentToken().text << " as " << token_type_to_string(type) << std::endl;
+            std::cout << "Consumed " << currentToken().text() << " as " << token_type_to_string(type) << std::endl;
         }
         nextToken();
     } else {
@@ -52,67 +55,154 @@ void ASTBuilder::consume(TokenType type) {
     }
 }
 
-void ASTBuilder::consume(TokenType type, std::string character) {
-    if(check(type) && currentToken().text == character) {
+// Like consume(), but a missing token is a syntax error
+bool ASTBuilder::expect(TokenType type) {
+    if(check(type)) {
         if(verbose) {
-            std::cout << "Consumed " << currentToken().text << " as " << token_type_to_string(type) << " " << character << std::endl;
+            std::cout << "Consumed " << currentToken().text() << " as " << token_type_to_string(type) << std::endl;
         }
         nextToken();
-    } else {
-        std::cout << std::endl << "*** Error line " << currentToken().line << "." << std::endl
-            << sourceCode.at(currentToken().line-1) << std::endl
-            << "  ^" << std::endl
-            << "*** syntax error" << std::endl << std::endl;
-        throw std::runtime_error("Syntax error");
+        return true;
     }
+    reportError(currentToken().line, "  ^");
+    return false;
 }
 
-void ASTBuilder::pushScope() {
-    symbolTable.push_back({});
+// Fails once a parse stack reaches MaxNesting frames. The rest of the
+// input is not parsed: recovering inside that much nesting would only
+// produce noise.
+bool ASTBuilder::checkNesting(size_t depth) {
+    if (depth < MaxNesting) {
+        return true;
+    }
+    reportError(currentToken().line, "", "nesting too deep");
+    while (!tokens.atEnd()) {
+        nextToken();
+    }
+    return false;
 }
 
-void ASTBuilder::popScope() {
-    if (!symbolTable.empty()) {
-        symbolTable.pop_back();
+// The EOF token has no position. An error there is reported on the line
+// of the last token consumed, and caretUnder() puts the caret just past it.
+void ASTBuilder::reportError(int line, const std::string& marker, const char* message) {
+    if (panicking) {
+        return;
+    }
+    if (line == 0) {
+        line = lastLine;
     }
+    errors.push_back(SyntaxError{line, marker, message});
+    panicking = true;
 }
 
-void ASTBuilder::addToCurrentScope(const std::string& name, ASTNodeType* type) {
-    if (symbolTable.empty()) {
-        pushScope(); // Ensure there's at least one scope
+std::string ASTBuilder::caretUnder(const Token& token) const {
+    int column = token.line > 0 ? token.column : lastColumn + 1;
+    return std::string(column > 1 ? column - 1 : 0, ' ') + "^";
+}
+
+// Panic mode recovery inside a function body: skips to just past the next
+// ';', or to the next brace, where a statement or the end of a block can
+// follow. At the end of the input there is nothing to resume at, so the
+// parser stays panicking and the unfinished blocks close silently.
+void ASTBuilder::synchronize() {
+    while (!tokens.atEnd()) {
+        TokenType type = currentToken().type;
+        if (type == TokenType::T_LeftBrace || type == TokenType::T_RightBrace) {
+            panicking = false;
+            return;
+        }
+        nextToken();
+        if (type == TokenType::T_Semicolon) {
+            panicking = false;
+            return;
+        }
     }
-    symbolTable.back()[name] = type;
 }
 
-ASTNodeType* ASTBuilder::lookupVariable(const std::string& name) {
-    for (auto it = symbolTable.rbegin(); it != symbolTable.rend(); ++it) {
-        auto& scope = *it;
-        auto found = scope.find(name);
-        if (found != scope.end()) {
-            return found->second;
+// Panic mode recovery between declarations: skips past the end of the one
+// that failed, a ';' or the '}' closing its body, or to a type at the top
+// level, which starts the next declaration.
+void ASTBuilder::synchronizeDecl() {
+    int depth = 0;
+    while (!tokens.atEnd()) {
+        TokenType type = currentToken().type;
+        if (depth == 0 && (type == TokenType::T_Void || type == TokenType::T_Int ||
+                           type == TokenType::T_Double || type == TokenType::T_Bool ||
+                           type == TokenType::T_String)) {
+            panicking = false;
+            return;
+        }
+        nextToken();
+        if (type == TokenType::T_LeftBrace) {
+            depth++;
+        } else if (type == TokenType::T_RightBrace && depth > 0) {
+            depth--;
+        }
+        if (depth == 0 && (type == TokenType::T_Semicolon || type == TokenType::T_RightBrace)) {
+            panicking = false;
+            return;
         }
     }
-    return ASTNodeType::errorType; // Not found
+}
+
+void ASTBuilder::writeErrors(OutputBuffer& out, size_t count) const {
+    for (size_t k = 0; k < count && k < errors.size(); k++) {
+        const SyntaxError& error = errors[k];
+        out.write("\n*** Error line ");
+        out.writeInt(error.line);
+        out.write(".\n");
+        out.write(source.line(error.line));
+        out.put('\n');
+        if (!error.marker.empty()) {
+            out.write(error.marker.data(), error.marker.size());
+            out.put('\n');
+        }
+        out.write("*** ");
+        out.write(error.message);
+        out.write("\n\n");
+    }
+}
+
+void ASTBuilder::pushScope() {
+    symbolTable.enterScope();
+}
+
+void ASTBuilder::popScope() {
+    symbolTable.exitScope();
+}
+
+// Outside every scope, symbols are declared at the outermost level, which
+// is never left
+void ASTBuilder::addToCurrentScope(uint32_t symbol, ASTNodeType* type) {
+    symbolTable.declare(symbol, type);
+}
+
+ASTNodeType* ASTBuilder::lookupVariable(uint32_t symbol) {
+    ASTNodeType* const* type = symbolTable.lookup(symbol);
+    return type ? *type : ASTNodeType::errorType; // Not found
 }
 
 // Main entry point for building the AST
-std::shared_ptr<ASTRootNode> ASTBuilder::buildAST() {
+ASTRootNode* ASTBuilder::buildAST() {
     return parseProgram();
 }
 
 // Program -> Decl+
-std::shared_ptr<ASTRootNode> ASTBuilder::parseProgram() {
+ASTRootNode* ASTBuilder::parseProgram() {
     int line = currentToken().line;
     int column = currentToken().column;
-    auto program = std::make_shared<ASTRootNode>(line, column);
+    auto program = arena.make<ASTRootNode>(arena, line, column);
     
-    while (currentTokenIndex < tokens.size()) {
-            auto decl = parseDecl();
-            if (decl) {
-                program->addDecl(decl);
-            } else {
+    while (!tokens.atEnd()) {
+        auto decl = parseDecl();
+        if (decl) {
+            program->addDecl(decl);
+        }
+        if (panicking) {
+            synchronizeDecl();
+        } else if (!decl) {
             // Skip invalid declaration and try to recover
-                    nextToken();
+            nextToken();
         }
     }
     
@@ -120,7 +210,7 @@ std::shared_ptr<ASTRootNode> ASTBuilder::parseProgram() {
 }
 
 // Decl -> VarDecl | FunctionDecl
-std::shared_ptr<Decl> ASTBuilder::parseDecl() {
+Decl* ASTBuilder::parseDecl() {
     // Check for type to determine if it's a declaration
     ASTNodeType* type = parseType();
     if (!type) return nullptr;
@@ -131,15 +221,16 @@ std::shared_ptr<Decl> ASTBuilder::parseDecl() {
         return nullptr;
     }
     
-    std::string identifierName = currentToken().text;
+    uint32_t symbol = currentToken().symbol;
+    TextRef name = currentToken().text();
     int line = currentToken().line;
     int column = currentToken().column;
     consume(TokenType::T_Identifier);
     
-    auto id = std::make_shared<Identifier>(identifierName, line, column);
+    auto id = arena.make<Identifier>(symbol, name, line, column);
     
     // If the next token is '(', it's a function declaration
-    if (check(TokenType::T_Operator) && currentToken().text == "(") {
+    if (check(TokenType::T_LeftParen)) {
         return parseFunctionDecl(type, id, line, column);
     } else {
         // Otherwise, it's a variable declaration
@@ -147,58 +238,52 @@ std::shared_ptr<Decl> ASTBuilder::parseDecl() {
     }
 }
 
-std::shared_ptr<FunctionDecl> ASTBuilder::parseFunctionDecl(
-    ASTNodeType* returnType, std::shared_ptr<Identifier> id, int line, int column) {
+FunctionDecl* ASTBuilder::parseFunctionDecl(
+    ASTNodeType* returnType, Identifier* id, int line, int column) {
     
-    auto funcDecl = std::make_shared<FunctionDecl>(returnType, id, line, column);
+    auto funcDecl = arena.make<FunctionDecl>(arena, returnType, id, line, column);
     
-    consume(TokenType::T_Operator, "(");
+    expect(TokenType::T_LeftParen);
     pushScope();
 
     // Parse parameters
-    if (!check(TokenType::T_Operator) || currentToken().text != ")") {
+    if (!check(TokenType::T_RightParen)) {
         while(true) {
             ASTNodeType* paramType = parseType();
-            if (!paramType) {
-                std::cerr << "Error: Expected parameter type at line " << currentToken().line << std::endl;
-                break;
-            }
-            
-            if (!check(TokenType::T_Identifier)) {
-                std::string indentStr(currentToken().column-1, ' ');
-                std::cout << std::endl << "*** Error line " << currentToken().line << "." << std::endl
-                << sourceCode.at(currentToken().line-1) << std::endl 
-                << indentStr << "^" << std::endl
-                << "*** syntax error" << std::endl << std::endl;
-                throw std::runtime_error("Syntax error");
+            if (!paramType || !check(TokenType::T_Identifier)) {
+                reportError(currentToken().line, caretUnder(currentToken()));
+                popScope();
+                return nullptr;
             }
             
-            std::string paramName = currentToken().text;
+            uint32_t paramSymbol = currentToken().symbol;
+            TextRef paramName = currentToken().text();
             int paramLine = currentToken().line;
             int paramColumn = currentToken().column;
             consume(TokenType::T_Identifier);
             
-            auto paramId = std::make_shared<Identifier>(paramName, paramLine, paramColumn);
-            auto param = std::make_shared<VarDecl>(paramType, paramId, nullptr, paramLine, paramColumn);
-            addToCurrentScope(paramName, paramType);
+            auto paramId = arena.make<Identifier>(paramSymbol, paramName, paramLine, paramColumn);
+            auto param = arena.make<VarDecl>(paramType, paramId, nullptr, paramLine, paramColumn);
+            addToCurrentScope(paramSymbol, paramType);
             funcDecl->addFormal(param);
             
-            if (currentToken().text != ",") {
+            if (!check(TokenType::T_Comma)) {
                 if(verbose) {
                     std::cout << "Exiting function declaration" << std::endl;
                 }
                 break;
             }
-            consume(TokenType::T_Operator, ",");
+            expect(TokenType::T_Comma);
         }
     }
 
     // Now explicitly check for and consume the closing parenthesis
-    if (!check(TokenType::T_Operator) || currentToken().text != ")") {
-        std::cerr << "Error: Expected ')' at line " << currentToken().line << std::endl;
-    } else {
-        consume(TokenType::T_Operator, ")");
+    if (!check(TokenType::T_RightParen)) {
+        reportError(currentToken().line, caretUnder(currentToken()));
+        popScope();
+        return nullptr;
     }
+    expect(TokenType::T_RightParen);
     
     // Parse function body
     auto body = parseBlock();
@@ -209,25 +294,26 @@ std::shared_ptr<FunctionDecl> ASTBuilder::parseFunctionDecl(
 }
 
 // Helper function to parse variable declaration after the type and identifier
-std::shared_ptr<VarDecl> ASTBuilder::parseVarDeclAfterType(
-    ASTNodeType* type, std::shared_ptr<Identifier> id, int line, int column) {
+VarDecl* ASTBuilder::parseVarDeclAfterType(
+    ASTNodeType* type, Identifier* id, int line, int column) {
     
-    std::shared_ptr<Expr> init = nullptr;
+    Expr* init = nullptr;
     
     // Check for initialization
-    if (check(TokenType::T_Operator) && currentToken().text == "=") {
-        consume(TokenType::T_Operator, "="); // Consume '='
+    if (check(TokenType::T_Assign)) {
+        expect(TokenType::T_Assign);
         init = parseExpr();
+        if (!init) return nullptr;
     }
     
-    consume(TokenType::T_Operator, ";"); // Consume ';'
-    addToCurrentScope(id->name, type);
+    if (!expect(TokenType::T_Semicolon)) return nullptr;
+    addToCurrentScope(id->symbol, type);
     
-    return std::make_shared<VarDecl>(type, id, init, line, column);
+    return arena.make<VarDecl>(type, id, init, line, column);
 }
 
 
-std::shared_ptr<VarDecl> ASTBuilder::parseVarDecl() {
+VarDecl* ASTBuilder::parseVarDecl() {
     int line = currentToken().line;
     int column = currentToken().column;
     
@@ -235,25 +321,27 @@ std::shared_ptr<VarDecl> ASTBuilder::parseVarDecl() {
     if (!type) return nullptr;
     
     if (!check(TokenType::T_Identifier)) {
-        std::cerr << "Error: Expected identifier after type at line " << line << std::endl;
+        reportError(currentToken().line, caretUnder(currentToken()));
         return nullptr;
     }
     
-    std::string name = currentToken().text;
+    uint32_t symbol = currentToken().symbol;
+    TextRef name = currentToken().text();
     consume(TokenType::T_Identifier);
     
-    auto id = std::make_shared<Identifier>(name, line, column);
-    std::shared_ptr<Expr> init = nullptr;
+    auto id = arena.make<Identifier>(symbol, name, line, column);
+    Expr* init = nullptr;
     
     // Check for initialization
-    if (check(TokenType::T_Operator) && currentToken().text == "=") {
-        consume(TokenType::T_Operator, "="); // Consume '='
+    if (check(TokenType::T_Assign)) {
+        expect(TokenType::T_Assign);
         init = parseExpr();
+        if (!init) return nullptr;
     }
     
-    consume(TokenType::T_Operator, ";"); // Consume ';'
+    if (!expect(TokenType::T_Semicolon)) return nullptr;
     
-    return std::make_shared<VarDecl>(type, id, init, line, column);
+    return arena.make<VarDecl>(type, id, init, line, column);
 }
 
 // Type -> 'void' | 'int' | 'double' | 'bool' | 'string'
@@ -277,66 +365,139 @@ ASTNodeType* ASTBuilder::parseType() {
 }
 
 // Block -> '{' Stmt* '}'
-std::shared_ptr<BlockStmt> ASTBuilder::parseBlock() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-
-    if (!check(TokenType::T_Operator) || currentToken().text != "{") {
-        std::cerr << "Error: Expected '{' at line " << line << std::endl; // Removed line-1
+BlockStmt* ASTBuilder::parseBlock() {
+    if (!check(TokenType::T_LeftBrace)) {
+        reportError(currentToken().line, caretUnder(currentToken()));
         return nullptr;
     }
-    
-    consume(TokenType::T_Operator, "{"); // Consume '{'
-    pushScope();
-    
-    auto block = std::make_shared<BlockStmt>(line, column);
-    
-    // Parse statements until we hit '}'
-    while (!check(TokenType::T_Operator) || currentToken().text != "}") {
-        auto stmt = parseStmt();
-        if (stmt) {
-            block->addStmt(stmt);
-        } else {
-            // Skip invalid statement and try to recover
-            nextToken();
-        }
-        
-        // Break if we've reached the end of the token stream
-        if (currentToken().type == TokenType::T_Unknown) {
-            if(verbose) {
-                std::cerr << "Warning: Unexpected end of file while parsing block" << std::endl;
+    return static_cast<BlockStmt*>(parseStmt());
+}
+
+// Stmt ->  Block | IfStmt | WhileStmt | ForStmt | ReturnStmt | BreakStmt | PrintStmt | ExprStmt | VarDeclStatement
+//
+// Blocks and the bodies of if, while and for statements nest without
+// bound, so instead of recursing, an open compound statement is pushed on
+// stmtStack and completed when its inner statement is done. A statement
+// with a syntax error is dropped after synchronize().
+Stmt* ASTBuilder::parseStmt() {
+    enum State { Start, BlockBody, BlockEnd, Done };
+
+    size_t base = stmtStack.size();
+    State state = Start;
+    Stmt* stmt = nullptr;
+    bool recovered = false; // stmt is null because of a syntax error
+
+    while (true) {
+        switch (state) {
+            // Open compound statements down to the next simple one
+            case Start: {
+                bool opened = true;
+                switch (currentToken().type) {
+                    case TokenType::T_LeftBrace:
+                        opened = openBlock();
+                        state = BlockBody;
+                        break;
+                    case TokenType::T_If:
+                        opened = openIfStmt();
+                        break;
+                    case TokenType::T_While:
+                        opened = openWhileStmt();
+                        break;
+                    case TokenType::T_For:
+                        opened = openForStmt();
+                        break;
+                    default:
+                        stmt = parseSimpleStmt();
+                        opened = !panicking;
+                        state = Done;
+                        break;
+                }
+                if (!opened) {
+                    synchronize();
+                    stmt = nullptr;
+                    recovered = true;
+                    state = Done;
+                }
+                break;
+            }
+
+            // Parse statements until we hit '}'
+            case BlockBody:
+                state = check(TokenType::T_RightBrace) ? BlockEnd : Start;
+                break;
+
+            case BlockEnd:
+                if (!expect(TokenType::T_RightBrace) && !tokens.atEnd()) {
+                    // A stray token such as an invalid character, the
+                    // block goes on after it
+                    synchronize();
+                    state = BlockBody;
+                    break;
+                }
+                popScope(); // Exit scope
+                stmt = stmtStack.back().block;
+                stmtStack.pop_back();
+                state = Done;
+                break;
+
+            // Hand the finished statement to the one waiting for it
+            case Done: {
+                if (stmtStack.size() == base) {
+                    return stmt;
+                }
+                StmtFrame& frame = stmtStack.back();
+                bool skipped = recovered;
+                recovered = false;
+                switch (frame.kind) {
+                    case StmtFrame::Block:
+                        if (stmt) {
+                            frame.block->addStmt(stmt);
+                        } else if (!skipped) {
+                            // Skip invalid statement and try to recover
+                            nextToken();
+                        }
+                        state = BlockBody;
+                        // Stop if we've reached the end of the token stream
+                        if (currentToken().type == TokenType::T_Unknown) {
+                            state = BlockEnd;
+                        }
+                        break;
+
+                    case StmtFrame::If:
+                        if (match(TokenType::T_Else)) {
+                            frame.kind = StmtFrame::Else;
+                            frame.thenStmt = stmt;
+                            state = Start;
+                            break;
+                        }
+                        stmt = arena.make<IfStmt>(frame.cond, stmt, nullptr, frame.line, frame.column);
+                        stmtStack.pop_back();
+                        break;
+
+                    case StmtFrame::Else:
+                        stmt = arena.make<IfStmt>(frame.cond, frame.thenStmt, stmt, frame.line, frame.column);
+                        stmtStack.pop_back();
+                        break;
+
+                    case StmtFrame::While:
+                        stmt = arena.make<WhileStmt>(frame.cond, stmt, frame.line, frame.column);
+                        stmtStack.pop_back();
+                        break;
+
+                    case StmtFrame::For:
+                        stmt = arena.make<ForStmt>(frame.init, frame.cond, frame.update, stmt,
+                                                   frame.line, frame.column);
+                        stmtStack.pop_back();
+                        break;
+                }
+                break;
             }
-            break;
         }
     }
-
-    consume(TokenType::T_Operator, "}"); // Consume '}'
-    popScope(); // Exit scope
-    return block;
 }
 
-// Stmt ->  Block | IfStmt | WhileStmt | ForStmt | ReturnStmt | BreakStmt | PrintStmt | ExprStmt | VarDeclStatement
-std::shared_ptr<Stmt> ASTBuilder::parseStmt() {
-    // Check for block statement
-    if (check(TokenType::T_Operator) && currentToken().text == "{") {
-        return parseBlock();
-    }
-    
-    // Check for if statement
-    if (check(TokenType::T_If)) {
-        return parseIfStmt();
-    }
-    
-    // Check for while statement
-    if (check(TokenType::T_While)) {
-        return parseWhileStmt();
-    }
-    
-    // Check for for statement
-    if (check(TokenType::T_For)) {
-        return parseForStmt();
-    }
-    
+// Stmt -> ReturnStmt | BreakStmt | PrintStmt | ExprStmt | VarDeclStatement
+Stmt* ASTBuilder::parseSimpleStmt() {
     // Check for return statement
     if (check(TokenType::T_Return)) {
         return parseReturnStmt();
@@ -365,461 +526,485 @@ std::shared_ptr<Stmt> ASTBuilder::parseStmt() {
         auto varDecl = parseVarDecl();
         if (!varDecl) return nullptr;
         
-        return std::make_shared<VarDeclStmt>(varDecl, varDecl->line, varDecl->column);
+        return arena.make<VarDeclStmt>(varDecl, varDecl->line, varDecl->column);
     }
     
     // Otherwise, it's an expression statement
     return parseExprStmt();
 }
 
+// The open* methods parse the head of a compound statement and push it on
+// stmtStack; parseStmt() builds the node once the body is parsed. They
+// return false after a syntax error in the head.
+
+bool ASTBuilder::openBlock() {
+    StmtFrame frame = StmtFrame();
+    frame.kind = StmtFrame::Block;
+    frame.line = currentToken().line;
+    frame.column = currentToken().column;
+    if (!checkNesting(stmtStack.size())) return false;
+
+    expect(TokenType::T_LeftBrace);
+    pushScope();
+
+    frame.block = arena.make<BlockStmt>(arena, frame.line, frame.column);
+    stmtStack.push_back(frame);
+    return true;
+}
+
 // IfStmt -> 'if' '(' Expr ')' Stmt ('else' Stmt)?
-std::shared_ptr<Stmt> ASTBuilder::parseIfStmt() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-    
+bool ASTBuilder::openIfStmt() {
+    StmtFrame frame = StmtFrame();
+    frame.kind = StmtFrame::If;
+    frame.line = currentToken().line;
+    frame.column = currentToken().column;
+    if (!checkNesting(stmtStack.size())) return false;
+
     consume(TokenType::T_If);
-    consume(TokenType::T_Operator, "("); // Consume '('
-    
-    auto condition = parseExpr();
+    if (!expect(TokenType::T_LeftParen)) return false;
     
-    consume(TokenType::T_Operator, ")"); // Consume ')'
+    frame.cond = parseExpr();
+    if (!frame.cond) return false;
     
-    auto thenStmt = parseStmt();
-    std::shared_ptr<Stmt> elseStmt = nullptr;
-    
-    if (match(TokenType::T_Else)) {
-        elseStmt = parseStmt();
-    }
-    
-    return std::make_shared<IfStmt>(condition, thenStmt, elseStmt, line, column);
+    if (!expect(TokenType::T_RightParen)) return false;
+    stmtStack.push_back(frame);
+    return true;
 }
 
 // WhileStmt -> 'while' '(' Expr ')' Stmt
-std::shared_ptr<Stmt> ASTBuilder::parseWhileStmt() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-    
+bool ASTBuilder::openWhileStmt() {
+    StmtFrame frame = StmtFrame();
+    frame.kind = StmtFrame::While;
+    frame.line = currentToken().line;
+    frame.column = currentToken().column;
+    if (!checkNesting(stmtStack.size())) return false;
+
     consume(TokenType::T_While);
-    consume(TokenType::T_Operator, "("); // Consume '('
-    
-    auto condition = parseExpr();
+    if (!expect(TokenType::T_LeftParen)) return false;
     
-    consume(TokenType::T_Operator, ")"); // Consume ')'
+    frame.cond = parseExpr();
+    if (!frame.cond) return false;
     
-    auto body = parseStmt();
-    
-    return std::make_shared<WhileStmt>(condition, body, line, column);
+    if (!expect(TokenType::T_RightParen)) return false;
+    stmtStack.push_back(frame);
+    return true;
 }
 
 // ForStmt -> 'for' '(' (Expr)? ';' Expr? ';' Expr? ')' Stmt
-std::shared_ptr<Stmt> ASTBuilder::parseForStmt() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-    
+bool ASTBuilder::openForStmt() {
+    StmtFrame frame = StmtFrame();
+    frame.kind = StmtFrame::For;
+    frame.line = currentToken().line;
+    frame.column = currentToken().column;
+    if (!checkNesting(stmtStack.size())) return false;
+
     consume(TokenType::T_For);
-    consume(TokenType::T_Operator, "("); // Consume '('
+    if (!expect(TokenType::T_LeftParen)) return false;
     
     // Parse initialization expression (optional)
-    std::shared_ptr<Expr> init = nullptr;
-    if (!check(TokenType::T_Operator) || currentToken().text != ";") {
-        init = parseExpr();
+    if (!check(TokenType::T_Semicolon)) {
+        frame.init = parseExpr();
+        if (!frame.init) return false;
     }
     
-    consume(TokenType::T_Operator, ";"); // Consume ';'
+    if (!expect(TokenType::T_Semicolon)) return false;
     
     // Parse condition expression (optional)
-    std::shared_ptr<Expr> cond = nullptr;
-    if (!check(TokenType::T_Operator) || currentToken().text != ";") {
-        cond = parseExpr();
+    if (!check(TokenType::T_Semicolon)) {
+        frame.cond = parseExpr();
+        if (!frame.cond) return false;
     }
     
-    consume(TokenType::T_Operator, ";"); // Consume ';'
+    if (!expect(TokenType::T_Semicolon)) return false;
     
     // Parse update expression (optional)
-    std::shared_ptr<Expr> update = nullptr;
-    if (!check(TokenType::T_Operator) || currentToken().text != ")") {
-        update = parseExpr();
+    if (!check(TokenType::T_RightParen)) {
+        frame.update = parseExpr();
+        if (!frame.update) return false;
     }
     
-    consume(TokenType::T_Operator, ")"); // Consume ')'
-    
-    auto body = parseStmt();
-    
-    return std::make_shared<ForStmt>(init, cond, update, body, line, column);
+    if (!expect(TokenType::T_RightParen)) return false;
+    stmtStack.push_back(frame);
+    return true;
 }
 
 // ReturnStmt -> 'return' Expr? ';'
-std::shared_ptr<Stmt> ASTBuilder::parseReturnStmt() {
+Stmt* ASTBuilder::parseReturnStmt() {
     int line = currentToken().line;
     int column = currentToken().column;
     
     consume(TokenType::T_Return);
     
-    std::shared_ptr<Expr> value = nullptr;
-    if (!check(TokenType::T_Operator) || currentToken().text != ";") {
+    Expr* value = nullptr;
+    if (!check(TokenType::T_Semicolon)) {
         value = parseExpr();
+        if (!value) return nullptr;
     }
     
-    consume(TokenType::T_Operator, ";"); // Consume ';'
+    if (!expect(TokenType::T_Semicolon)) return nullptr;
     
-    return std::make_shared<ReturnStmt>(value, line, column);
+    return arena.make<ReturnStmt>(value, line, column);
 }
 
 // BreakStmt -> 'break' ';'
-std::shared_ptr<Stmt> ASTBuilder::parseBreakStmt() {
+Stmt* ASTBuilder::parseBreakStmt() {
     int line = currentToken().line;
     int column = currentToken().column;
     
     consume(TokenType::T_Break);
-    consume(TokenType::T_Operator, ";"); // Consume ';'
+    if (!expect(TokenType::T_Semicolon)) return nullptr;
     
-    return std::make_shared<BreakStmt>(line, column);
+    return arena.make<BreakStmt>(line, column);
 }
 
 // PrintStmt -> 'Print' '(' Expr (',' Expr)* ')' ';'
-std::shared_ptr<Stmt> ASTBuilder::parsePrintStmt() {
+Stmt* ASTBuilder::parsePrintStmt() {
     int line = currentToken().line;
     int column = currentToken().column;
     
     consume(TokenType::T_Print);
-    consume(TokenType::T_Operator, "("); // Consume '('
+    if (!expect(TokenType::T_LeftParen)) return nullptr;
     
-    auto printStmt = std::make_shared<PrintStmt>(line, column);
+    auto printStmt = arena.make<PrintStmt>(arena, line, column);
     
     // Parse at least one expression
-    if (!check(TokenType::T_Operator) || currentToken().text != ")") {
+    if (!check(TokenType::T_RightParen)) {
         do {
             auto arg = parseExpr();
+            if (!arg) return nullptr;
             printStmt->addArg(arg);
-            if (!check(TokenType::T_Operator) || currentToken().text != ",") break;
-            consume(TokenType::T_Operator, ",");
+            if (!check(TokenType::T_Comma)) break;
+            expect(TokenType::T_Comma);
         } while (true);
     }
     
-    consume(TokenType::T_Operator, ")"); // Consume ')'
-    consume(TokenType::T_Operator, ";"); // Consume ';'
+    if (!expect(TokenType::T_RightParen) || !expect(TokenType::T_Semicolon)) {
+        return nullptr;
+    }
     
     return printStmt;
 }
 
 // ExprStmt -> Expr ';'
-std::shared_ptr<Stmt> ASTBuilder::parseExprStmt() {
+Stmt* ASTBuilder::parseExprStmt() {
     int line = currentToken().line;
     int column = currentToken().column;
     
     auto expr = parseExpr();
+    if (!expr) return nullptr;
     
-    consume(TokenType::T_Operator, ";"); // Consume ';'
+    if (!expect(TokenType::T_Semicolon)) return nullptr;
     
-    return std::make_shared<ExprStmt>(expr, line, column);
+    return arena.make<ExprStmt>(expr, line, column);
 }
 
-// Expression parsing methods follow precedence rules
-// Expr -> Assignment
-std::shared_ptr<Expr> ASTBuilder::parseExpr() {
-    return parseAssignment();
-}
+// Binary operators by token kind. Precedence 0 means the token does not
+// continue an expression; higher binds tighter. Assignment is the only
+// right associative operator.
+struct BinaryOperator {
+    int precedence;
+    BinaryExpr::BinaryOp op;
+};
 
-// Assignment -> LogicalOr ('=' Assignment)?
-std::shared_ptr<Expr> ASTBuilder::parseAssignment() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-    
-    auto expr = parseLogicalOr();
-    
-    if (check(TokenType::T_Operator) && currentToken().text == "=") {
-        consume(TokenType::T_Operator, "="); // Consume '='
-        auto value = parseAssignment();
-        expr = std::make_shared<AssignExpr>(expr, value, line, column);
-    }
-    
-    return expr;
-}
+static const int AssignPrecedence = 1;
 
-// LogicalOr -> LogicalAnd ('||' LogicalAnd)*
-std::shared_ptr<Expr> ASTBuilder::parseLogicalOr() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-    
-    auto expr = parseLogicalAnd();
-    
-    while (check(TokenType::T_Or)) {
-        consume(TokenType::T_Or);
-        auto right = parseLogicalAnd();
-        expr = std::make_shared<BinaryExpr>(BinaryExpr::Or, expr, right, line, column);
+static BinaryOperator binary_operator(TokenType type) {
+    switch (type) {
+        case TokenType::T_Assign:       return {AssignPrecedence, BinaryExpr::Plus};
+        case TokenType::T_Or:           return {2, BinaryExpr::Or};
+        case TokenType::T_And:          return {3, BinaryExpr::And};
+        case TokenType::T_Equal:        return {4, BinaryExpr::Equal};
+        case TokenType::T_NotEqual:     return {4, BinaryExpr::NotEqual};
+        case TokenType::T_Less:         return {5, BinaryExpr::Less};
+        case TokenType::T_LessEqual:    return {5, BinaryExpr::LessEqual};
+        case TokenType::T_Greater:      return {5, BinaryExpr::Greater};
+        case TokenType::T_GreaterEqual: return {5, BinaryExpr::GreaterEqual};
+        case TokenType::T_Plus:         return {6, BinaryExpr::Plus};
+        case TokenType::T_Minus:        return {6, BinaryExpr::Minus};
+        case TokenType::T_Star:         return {7, BinaryExpr::Multiply};
+        case TokenType::T_Slash:        return {7, BinaryExpr::Divide};
+        case TokenType::T_Percent:      return {7, BinaryExpr::Modulo};
+        default:                        return {0, BinaryExpr::Plus};
     }
-    
-    return expr;
 }
 
-// LogicalAnd -> Equality ('&&' Equality)*
-std::shared_ptr<Expr> ASTBuilder::parseLogicalAnd() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-    
-    auto expr = parseEquality();
-    
-    while (check(TokenType::T_And)) {
-        consume(TokenType::T_And); // Consume '&&'
-        auto right = parseEquality();
-        expr = std::make_shared<BinaryExpr>(BinaryExpr::And, expr, right, line, column);
-    }
-    
-    return expr;
-}
+// Expr -> Binary
+// Binary -> Unary (BinaryOp Binary)*
+// Unary -> ('-' | '!') Unary | Call
+// Call -> Primary ('(' Args ')')?
+// Primary -> '(' Expr ')' | ...
+//
+// Precedence climbing, with the grammar's recursion kept on exprStack so
+// that deeply nested input cannot overflow the native stack. A Binary
+// frame is one level of the climb: it folds in every following operator
+// that binds at least as tightly as its minPrecedence, and holds the
+// operator waiting for its right side. Unary, Paren and Call frames wait
+// for their operand, the parenthesized expression and the next argument.
+// Every binary node is positioned at the first token of its left operand
+// chain, every call at the first token of its primary. After a syntax
+// error the frames are dropped and the result is null.
+Expr* ASTBuilder::parseExpr() {
+    enum State { CallSuffix, Operand, Operators, Returned, NeedOperand, Abandon };
+
+    size_t base = exprStack.size();
+    int minPrecedence = AssignPrecedence;
 
-// Equality -> Relational (('==' | '!=') Relational)*
-std::shared_ptr<Expr> ASTBuilder::parseEquality() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-    
-    auto expr = parseRelational();
-    
     while (true) {
-        if (check(TokenType::T_Equal)) {
-            consume(TokenType::T_Equal);
-            auto right = parseRelational();
-            expr = std::make_shared<BinaryExpr>(BinaryExpr::Equal, expr, right, line, column);
-        } else if (check(TokenType::T_NotEqual)) {
-            consume(TokenType::T_NotEqual); // Consume '!='
-            auto right = parseRelational();
-            expr = std::make_shared<BinaryExpr>(BinaryExpr::NotEqual, expr, right, line, column);
-        } else {
-            break;
+        ExprFrame frame = ExprFrame();
+        frame.kind = ExprFrame::Binary;
+        frame.line = currentToken().line;
+        frame.column = currentToken().column;
+        frame.minPrecedence = minPrecedence;
+        if (!checkNesting(exprStack.size())) break;
+        exprStack.push_back(frame);
+
+        while (check(TokenType::T_Minus) || check(TokenType::T_Not)) {
+            frame.kind = ExprFrame::Unary;
+            frame.line = currentToken().line;
+            frame.column = currentToken().column;
+            frame.op = check(TokenType::T_Minus) ? UnaryExpr::Minus : UnaryExpr::Not;
+            if (!checkNesting(exprStack.size())) break;
+            exprStack.push_back(frame);
+            expect(currentToken().type);
         }
-    }
-    
-    return expr;
-}
+        if (panicking) break;
 
-// Relational -> Additive (('<' | '<=' | '>' | '>=') Additive)*
-std::shared_ptr<Expr> ASTBuilder::parseRelational() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-    
-    auto expr = parseAdditive();
-    
-    while (true) {
-        if (check(TokenType::T_Operator) && currentToken().text == "<") {
-            consume(TokenType::T_Operator, "<"); // Consume '<'
-            auto right = parseAdditive();
-            expr = std::make_shared<BinaryExpr>(BinaryExpr::Less, expr, right, line, column);
-        } else if (check(TokenType::T_LessEqual)) {
-            consume(TokenType::T_LessEqual);
-            auto right = parseAdditive();
-            expr = std::make_shared<BinaryExpr>(BinaryExpr::LessEqual, expr, right, line, column);
-        } else if (check(TokenType::T_Operator) && currentToken().text == ">") {
-            consume(TokenType::T_Operator, ">"); // Consume '>'
-            auto right = parseAdditive();
-            expr = std::make_shared<BinaryExpr>(BinaryExpr::Greater, expr, right, line, column);
-        } else if (check(TokenType::T_GreaterEqual)) {
-            consume(TokenType::T_GreaterEqual);
-            auto right = parseAdditive();
-            expr = std::make_shared<BinaryExpr>(BinaryExpr::GreaterEqual, expr, right, line, column);
-        } else {
-            break;
-        }
-    }
-    
-    return expr;
-}
+        // Position of the Call production
+        int line = currentToken().line;
+        int column = currentToken().column;
 
-// Additive -> Multiplicative (('+' | '-') Multiplicative)*
-std::shared_ptr<Expr> ASTBuilder::parseAdditive() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-    
-    auto expr = parseMultiplicative();
-    
-    while (true) {
-        if (check(TokenType::T_Operator) && currentToken().text == "+") {
-            consume(TokenType::T_Operator, "+"); // Consume '+'
-            auto right = parseMultiplicative();
-            expr = std::make_shared<BinaryExpr>(BinaryExpr::Plus, expr, right, line, column);
-        } else if (check(TokenType::T_Operator) && currentToken().text == "-") {
-            consume(TokenType::T_Operator, "-"); // Consume '-'
-            auto right = parseMultiplicative();
-            expr = std::make_shared<BinaryExpr>(BinaryExpr::Minus, expr, right, line, column);
-        } else {
-            break;
+        if (check(TokenType::T_LeftParen)) {
+            nextToken();
+            frame.kind = ExprFrame::Paren;
+            frame.line = line;
+            frame.column = column;
+            if (!checkNesting(exprStack.size())) break;
+            exprStack.push_back(frame);
+            minPrecedence = AssignPrecedence;
+            continue;
         }
-    }
-    
-    return expr;
-}
 
-// Multiplicative -> Unary (('*' | '/' | '%') Unary)*
-std::shared_ptr<Expr> ASTBuilder::parseMultiplicative() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-    
-    auto expr = parseUnary();
-    
-    while (true) {
-        if (check(TokenType::T_Operator) && currentToken().text == "*") {
-            consume(TokenType::T_Operator, "*"); // Consume '*'
-            auto right = parseUnary();
-            expr = std::make_shared<BinaryExpr>(BinaryExpr::Multiply, expr, right, line, column);
-        } else if (check(TokenType::T_Operator) && currentToken().text == "/") {
-            consume(TokenType::T_Operator, "/"); // Consume '/'
-            auto right = parseUnary();
-            expr = std::make_shared<BinaryExpr>(BinaryExpr::Divide, expr, right, line, column);
-        } else if (check(TokenType::T_Operator) && currentToken().text == "%") {
-            consume(TokenType::T_Operator, "%"); // Consume '%'
-            auto right = parseUnary();
-            expr = std::make_shared<BinaryExpr>(BinaryExpr::Modulo, expr, right, line, column);
-        } else {
-            break;
+        Expr* value = parsePrimary();
+        if (!value) break;
+        State state = CallSuffix;
+
+        // Hand the finished value to the frames waiting for it, until one
+        // needs another operand
+        while (state != NeedOperand) {
+            switch (state) {
+                case CallSuffix:
+                    state = Operand;
+                    if (!check(TokenType::T_LeftParen)) {
+                        break;
+                    }
+                    // Handle function call, only a function name can be called
+                    if (value->nodeKind == NodeKind::VarExpr) {
+                        expect(TokenType::T_LeftParen);
+                        auto var = static_cast<VarExpr*>(value);
+                        auto callExpr = arena.make<CallExpr>(arena, var->id, line, column);
+
+                        // Parse arguments if any
+                        if (!check(TokenType::T_RightParen)) {
+                            if (!checkNesting(exprStack.size())) {
+                                state = Abandon;
+                                break;
+                            }
+                            frame.kind = ExprFrame::Call;
+                            frame.expr = callExpr;
+                            exprStack.push_back(frame);
+                            minPrecedence = AssignPrecedence;
+                            state = NeedOperand;
+                            break;
+                        }
+                        expect(TokenType::T_RightParen);
+                        value = ended(callExpr);
+                    } else {
+                        reportError(currentToken().line, caretUnder(currentToken()));
+                        state = Abandon;
+                    }
+                    break;
+
+                // value is a Call: apply the unary operators before it and
+                // start the chain of the Binary frame below them
+                case Operand:
+                    while (exprStack.back().kind == ExprFrame::Unary) {
+                        const ExprFrame& unary = exprStack.back();
+                        value = ended(arena.make<UnaryExpr>((UnaryExpr::UnaryOp)unary.op, value,
+                                                            unary.line, unary.column));
+                        exprStack.pop_back();
+                    }
+                    exprStack.back().expr = value;
+                    state = Operators;
+                    break;
+
+                case Operators: {
+                    ExprFrame& binary = exprStack.back();
+                    BinaryOperator next = binary_operator(currentToken().type);
+                    if (next.precedence < binary.minPrecedence || next.precedence == 0) {
+                        // End of the chain, which is the value of the Binary
+                        value = binary.expr;
+                        exprStack.pop_back();
+                        state = Returned;
+                        break;
+                    }
+
+                    // Assignment is right associative, the others bind left
+                    binary.opLine = currentToken().line;
+                    binary.opColumn = currentToken().column;
+                    nextToken(); // Consume the operator
+                    binary.pending = next.precedence;
+                    binary.op = next.op;
+                    minPrecedence = next.precedence == AssignPrecedence ? AssignPrecedence : next.precedence + 1;
+                    state = NeedOperand;
+                    break;
+                }
+
+                // value is a whole Binary
+                case Returned: {
+                    if (exprStack.size() == base) {
+                        return value;
+                    }
+                    ExprFrame& waiting = exprStack.back();
+                    if (waiting.kind == ExprFrame::Binary) {
+                        if (waiting.pending == AssignPrecedence) {
+                            auto assign = ended(arena.make<AssignExpr>(waiting.expr, value,
+                                                                       waiting.line, waiting.column));
+                            assign->opLine = waiting.opLine;
+                            assign->opColumn = waiting.opColumn;
+                            waiting.expr = assign;
+                        } else {
+                            auto binary = ended(arena.make<BinaryExpr>((BinaryExpr::BinaryOp)waiting.op,
+                                                                       waiting.expr, value,
+                                                                       waiting.line, waiting.column));
+                            binary->opLine = waiting.opLine;
+                            binary->opColumn = waiting.opColumn;
+                            waiting.expr = binary;
+                        }
+                        waiting.pending = 0;
+                        state = Operators;
+                    } else if (waiting.kind == ExprFrame::Paren) {
+                        if (!expect(TokenType::T_RightParen)) {
+                            state = Abandon;
+                            break;
+                        }
+                        line = waiting.line;
+                        column = waiting.column;
+                        exprStack.pop_back();
+                        state = CallSuffix;
+                    } else {
+                        auto callExpr = static_cast<CallExpr*>(waiting.expr);
+                        callExpr->addArg(value);
+                        if (check(TokenType::T_Comma)) {
+                            expect(TokenType::T_Comma);
+                            minPrecedence = AssignPrecedence;
+                            state = NeedOperand;
+                            break;
+                        }
+                        if (!expect(TokenType::T_RightParen)) {
+                            state = Abandon;
+                            break;
+                        }
+                        value = ended(callExpr);
+                        exprStack.pop_back();
+                        state = Operand;
+                    }
+                    break;
+                }
+
+                case NeedOperand:
+                    break;
+
+                case Abandon:
+                    exprStack.resize(base);
+                    return nullptr;
+            }
         }
     }
-    
-    return expr;
-}
 
-// Unary -> ('-' | '!') Unary | Call
-std::shared_ptr<Expr> ASTBuilder::parseUnary() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-    
-    if (check(TokenType::T_Operator) && currentToken().text == "-") {
-        consume(TokenType::T_Operator, "-"); // Consume '-'
-        auto right = parseUnary();
-        return std::make_shared<UnaryExpr>(UnaryExpr::Minus, right, line, column);
-    } else if (check(TokenType::T_Operator) && currentToken().text == "!") {
-        consume(TokenType::T_Operator, "!"); // Consume '!'
-        auto right = parseUnary();
-        return std::make_shared<UnaryExpr>(UnaryExpr::Not, right, line, column);
-    }
-    
-    return parseCall();
+    // Syntax error while looking for an operand
+    exprStack.resize(base);
+    return nullptr;
 }
 
-// Call -> Primary ('(' Args ')')?
-std::shared_ptr<Expr> ASTBuilder::parseCall() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-    
-    auto expr = parsePrimary();
-    
-    if (check(TokenType::T_Operator) && currentToken().text == "(") {
-        // Handle function call
-        consume(TokenType::T_Operator, "("); // Consume '('
-        
-        // Check if it's a function identifier
-        if (auto var = std::dynamic_pointer_cast<VarExpr>(expr)) {
-            auto callExpr = std::make_shared<CallExpr>(var->id, line, column);
-            
-            // Parse arguments if any
-            if (!check(TokenType::T_Operator) || currentToken().text != ")") {
-                // Parse the first argument
-                auto arg = parseExpr();
-                callExpr->addArg(arg);
-
-                // Parse all other args
-                while (check(TokenType::T_Operator) && currentToken().text == ",") {
-                    consume(TokenType::T_Operator, ",");
-                    arg = parseExpr();
-                    callExpr->addArg(arg);
-                }
+// Primary -> IntConstant | DoubleConstant | StringConstant | BoolConstant | Identifier
+//          | ReadInteger '(' ')' | ReadLine '(' ')'
+// Parenthesized expressions are handled by parseExpr()
+Expr* ASTBuilder::parsePrimary() {
+    const Token& token = currentToken();
+    int line = token.line;
+    int column = token.column;
+
+    // Literals that do not fit their type fall through to the syntax error below
+    switch (token.type) {
+        case TokenType::T_IntConstant:
+            if (!token.overflow) {
+                int value = token.intValue;
+                nextToken();
+                return ended(arena.make<IntLiteral>(value, line, column));
             }
-            consume(TokenType::T_Operator, ")"); // Consume ')'
-            
-            return callExpr;
-        } else {
-            std::cerr << "Error: Cannot call non-function at line " << line << std::endl;
-            // Skip to closing parenthesis
-            while (!check(TokenType::T_Operator) || currentToken().text != ")") {
+            break;
+
+        case TokenType::T_DoubleConstant:
+            if (!token.overflow) {
+                double value = token.doubleValue;
                 nextToken();
+                return ended(arena.make<DoubleLiteral>(value, line, column));
             }
-            consume(TokenType::T_Operator, ")"); // Consume ')'
-            return expr;
+            break;
+
+        case TokenType::T_StringConstant: {
+            TextRef value = token.text();
+            nextToken();
+            return ended(arena.make<StringLiteral>(value, line, column));
         }
-    }
-    
-    return expr;
-}
 
-// Primary -> IntConstant | DoubleConstant | StringConstant | BoolConstant | 'null' | '(' Expr ')' | Identifier
-std::shared_ptr<Expr> ASTBuilder::parsePrimary() {
-    int line = currentToken().line;
-    int column = currentToken().column;
-    
-    // Parse integer literal
-    if (check(TokenType::T_IntConstant)) {
-        int value = std::stoi(currentToken().text);
-        consume(TokenType::T_IntConstant);
-        return std::make_shared<IntLiteral>(value, line, column);
-    }
-    
-    // Parse double literal
-    if (check(TokenType::T_DoubleConstant)) {
-        double value = std::stod(currentToken().text);
-        consume(TokenType::T_DoubleConstant);
-        return std::make_shared<DoubleLiteral>(value, line, column);
-    }
-    
-    // Parse string literal
-    if (check(TokenType::T_StringConstant)) {
-        std::string value = currentToken().text;
-        consume(TokenType::T_StringConstant);
-        return std::make_shared<StringLiteral>(value, line, column);
-    }
-    
-    // Parse boolean literal
-    if (check(TokenType::T_BoolConstant)) {
-        bool value = (currentToken().text == "true");
-        consume(TokenType::T_BoolConstant);
-        return std::make_shared<BoolLiteral>(value, line, column);
-    }
-    
-    // Parse null literal
-    if (check(TokenType::T_Operator) && currentToken().text == "null") {
-        consume(TokenType::T_Operator, "null");
-        return std::make_shared<NullLiteral>(line, column);
-    }
-    
-    // Parse parenthesized expression
-    if (check(TokenType::T_Operator) && currentToken().text == "(") {
-        consume(TokenType::T_Operator, "("); // Consume '('
-        auto expr = parseExpr();
-        consume(TokenType::T_Operator, ")"); // Consume ')'
-        return expr;
-    }
-    
-    // Parse identifier (variable reference)
-    if (check(TokenType::T_Identifier)) {
-        std::string name = currentToken().text;
-        consume(TokenType::T_Identifier);
-        auto id = std::make_shared<Identifier>(name, line, column);
-        return std::make_shared<VarExpr>(id, line, column, lookupVariable(name));
-    }
+        case TokenType::T_BoolConstant: {
+            bool value = token.intValue != 0;
+            nextToken();
+            return ended(arena.make<BoolLiteral>(value, line, column));
+        }
 
-    if (check(TokenType::T_ReadInteger)) {
-        int line = currentToken().line;
-        int column = currentToken().column;
-        consume(TokenType::T_ReadInteger);
-        consume(TokenType::T_Operator, "(");
-        consume(TokenType::T_Operator, ")");
-        return std::make_shared<ReadIntegerExpr>(line, column);
+        // Variable reference
+        case TokenType::T_Identifier: {
+            uint32_t symbol = token.symbol;
+            TextRef name = token.text();
+            nextToken();
+            auto id = arena.make<Identifier>(symbol, name, line, column);
+            return ended(arena.make<VarExpr>(id, line, column, lookupVariable(symbol)));
+        }
+
+        case TokenType::T_ReadInteger:
+            nextToken();
+            if (!expect(TokenType::T_LeftParen) || !expect(TokenType::T_RightParen)) {
+                return nullptr;
+            }
+            return ended(arena.make<ReadIntegerExpr>(line, column));
+
+        case TokenType::T_ReadLine:
+            nextToken();
+            if (!expect(TokenType::T_LeftParen) || !expect(TokenType::T_RightParen)) {
+                return nullptr;
+            }
+            return ended(arena.make<ReadLineExpr>(line, column));
+
+        default:
+            break;
     }
-    
-    // Remove white space
-    std::string srcLine = sourceCode.at(line-1);
-    std::string::iterator end_pos = std::remove(srcLine.begin(), srcLine.end(), ' ');
-    srcLine.erase(end_pos, srcLine.end());
 
-    // Print syntax error
-    std::string errorHighlight(srcLine.size(), '^');
-    std::cout << std::endl << "*** Error line " << line << "." << std::endl 
-              << sourceCode.at(line-1) << std::endl 
-              << "    " << errorHighlight<< std::endl
-              << "*** syntax error" << std::endl << std::endl;
-    
-    throw std::runtime_error("Syntax error");
+    // Highlight every non space character of the line
+    TextRef srcLine = source.line(line);
+    size_t spaces = std::count(srcLine.data(), srcLine.data() + srcLine.size(), ' ');
+
+    std::string errorHighlight(srcLine.size() - spaces, '^');
+    reportError(line, "    " + errorHighlight);
+    return nullptr;
 }
 
 // Usage example:
-// std::vector<Token> tokens = lexer.tokenize(sourceCode);
-// ASTBuilder builder(tokens);
-// std::shared_ptr<Program> ast = builder.buildAST();
-// ast->print(); // Print the AST for debugging
\ No newline at end of file
+// scanner.start(source.text());
+// TokenStream tokens(scanner);
+// Arena arena;
+// ASTBuilder builder(tokens, source, arena);
+// ASTRootNode* ast = builder.buildAST();
+// OutputBuffer out;
+// ASTPrinter(out).print(ast); // Print the AST for debugging
\ No newline at end of file
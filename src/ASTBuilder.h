@@ -1,13 +1,15 @@
 #pragma once
 
 #include <vector>
-#include <memory>
 #include <string>
 #include <iostream>
-#include <unordered_map>
 
 #include "ASTNodes.h"
 #include "Scanner.h"
+#include "SourceFile.h"
+#include "TokenStream.h"
+#include "OutputBuffer.h"
+#include "SymbolTable.h"
 
 // Forward declarations
 class ASTRootNode;
@@ -20,73 +22,152 @@ class Expr;
 class Identifier;
 class ASTNodeType;
 
+// A syntax error, written as
+//
+//   *** Error line <line>.
+//   <the source line>
+//   <marker, if any>
+//   *** <message>
+struct SyntaxError {
+    int line;
+    std::string marker;
+    const char* message;
+};
+
 class ASTBuilder {
 private:
-    std::vector<Token> tokens;
-    std::vector<std::string> sourceCode; // For logging purposes only
-    size_t currentTokenIndex;
+    TokenStream& tokens;
+    const SourceFile& source; // For logging purposes only
+    Arena& arena;             // Owns every node of the AST
+    bool advancedPastEnd;
     bool verbose;
 
-    // Tracking variables, their type, and their scope
-    std::vector<std::unordered_map<std::string, ASTNodeType*>> symbolTable;
+    // Last character of the token consumed last, where the expression
+    // completed by that token ends
+    int lastLine;
+    int lastColumn;
+
+    template <typename T>
+    T* ended(T* expr) {
+        expr->endLine = lastLine;
+        expr->endColumn = lastColumn;
+        return expr;
+    }
+
+    // Syntax errors in source order. After one is reported the parser is
+    // panicking: further errors are dropped and the production at hand is
+    // abandoned, up to the statement or declaration where synchronize()
+    // or synchronizeDecl() finds a token to resume at.
+    std::vector<SyntaxError> errors;
+    bool panicking;
+
+    void reportError(int line, const std::string& marker, const char* message = "syntax error");
+    std::string caretUnder(const Token& token) const;
+    void synchronize();
+    void synchronizeDecl();
+
+    // Tracking variables, their type, and their scope, keyed by symbol ID
+    SymbolTable<ASTNodeType*> symbolTable;
+
+    // Statements and expressions nest without bound, so the parser keeps
+    // the productions waiting on an inner statement or expression on these
+    // stacks instead of recursing. See parseStmt() and parseExpr().
+    struct StmtFrame {
+        enum Kind { Block, If, Else, While, For };
+        Kind kind;
+        int line;
+        int column;
+        BlockStmt* block;  // Block
+        Stmt* thenStmt;    // Else
+        Expr* init;        // For
+        Expr* cond;        // If, Else, While, For
+        Expr* update;      // For
+    };
+
+    struct ExprFrame {
+        enum Kind { Binary, Unary, Paren, Call };
+        Kind kind;
+        int line;
+        int column;
+        int minPrecedence; // Binary: operators looser than this end the chain
+        int pending;       // Binary: precedence of the operator awaiting its right side, 0 if none
+        int op;            // Binary: that operator; Unary: the UnaryOp
+        int opLine;        // Binary: position of that operator
+        int opColumn;
+        Expr* expr;        // Binary: the chain so far; Call: the CallExpr
+    };
+
+    std::vector<StmtFrame> stmtStack;
+    std::vector<ExprFrame> exprStack;
+
+    bool checkNesting(size_t depth);
 
     void pushScope();
     void popScope();
-    void addToCurrentScope(const std::string& name, ASTNodeType* type);
-    ASTNodeType* lookupVariable(const std::string& name);
+    void addToCurrentScope(uint32_t symbol, ASTNodeType* type);
+    ASTNodeType* lookupVariable(uint32_t symbol);
 
     // Token handling helpers
-    Token currentToken() const;
+    const Token& currentToken() const;
     void nextToken();
     bool match(TokenType type);
     bool check(TokenType type) const;
     void consume(TokenType type);
-    void consume(TokenType type, std::string character);
+    bool expect(TokenType type);
 
     // AST node parsing methods
-    std::shared_ptr<ASTRootNode> parseProgram();
-    std::shared_ptr<Decl> parseDecl();
-    std::shared_ptr<FunctionDecl> parseFunctionDecl(ASTNodeType* returnType, std::shared_ptr<Identifier> id, int line, int column);
-    std::shared_ptr<VarDecl> parseVarDeclAfterType(ASTNodeType* type, std::shared_ptr<Identifier> id, int line, int column);
-    std::shared_ptr<VarDecl> parseVarDecl();
+    ASTRootNode* parseProgram();
+    Decl* parseDecl();
+    FunctionDecl* parseFunctionDecl(ASTNodeType* returnType, Identifier* id, int line, int column);
+    VarDecl* parseVarDeclAfterType(ASTNodeType* type, Identifier* id, int line, int column);
+    VarDecl* parseVarDecl();
     ASTNodeType* parseType();
-    std::shared_ptr<BlockStmt> parseBlock();
-    std::shared_ptr<Stmt> parseStmt();
-    std::shared_ptr<Stmt> parseIfStmt();
-    std::shared_ptr<Stmt> parseWhileStmt();
-    std::shared_ptr<Stmt> parseForStmt();
-    std::shared_ptr<Stmt> parseReturnStmt();
-    std::shared_ptr<Stmt> parseBreakStmt();
-    std::shared_ptr<Stmt> parsePrintStmt();
-    std::shared_ptr<Stmt> parseExprStmt();
-
-    // Expression parsing methods (in order of precedence)
-    std::shared_ptr<Expr> parseExpr();
-    std::shared_ptr<Expr> parseAssignment();
-    std::shared_ptr<Expr> parseLogicalOr();
-    std::shared_ptr<Expr> parseLogicalAnd();
-    std::shared_ptr<Expr> parseEquality();
-    std::shared_ptr<Expr> parseRelational();
-    std::shared_ptr<Expr> parseAdditive();
-    std::shared_ptr<Expr> parseMultiplicative();
-    std::shared_ptr<Expr> parseUnary();
-    std::shared_ptr<Expr> parseCall();
-    std::shared_ptr<Expr> parsePrimary();
+    BlockStmt* parseBlock();
+    Stmt* parseStmt();
+    Stmt* parseSimpleStmt();
+    bool openBlock();
+    bool openIfStmt();
+    bool openWhileStmt();
+    bool openForStmt();
+    Stmt* parseReturnStmt();
+    Stmt* parseBreakStmt();
+    Stmt* parsePrintStmt();
+    Stmt* parseExprStmt();
+
+    // Expression parsing methods
+    Expr* parseExpr();
+    Expr* parsePrimary();
 
 public:
-    explicit ASTBuilder(const std::vector<Token>& tokens, const std::vector<std::string>& sourceCode) {
-        this->currentTokenIndex = 0;
-        this->tokens = tokens;
-        this->sourceCode = sourceCode;
+    // Deepest nesting accepted, counted in frames on either stack. Deeper
+    // input gets a diagnostic rather than unbounded memory use.
+    static const size_t MaxNesting = 1 << 20;
+
+    explicit ASTBuilder(TokenStream& tokens, const SourceFile& source, Arena& arena)
+        : tokens(tokens), source(source), arena(arena) {
+        this->advancedPastEnd = false;
         this->verbose = false;
+        this->panicking = false;
+        this->lastLine = 0;
+        this->lastColumn = 0;
     }
 
-    explicit ASTBuilder(const std::vector<Token>& tokens, const std::vector<std::string>& sourceCode, bool verbose) {
-        this->currentTokenIndex = 0;
-        this->tokens = tokens;
-        this->sourceCode = sourceCode;
+    explicit ASTBuilder(TokenStream& tokens, const SourceFile& source, Arena& arena, bool verbose)
+        : tokens(tokens), source(source), arena(arena) {
+        this->advancedPastEnd = false;
         this->verbose = verbose;
+        this->panicking = false;
+        this->lastLine = 0;
+        this->lastColumn = 0;
     }
 
-    std::shared_ptr<ASTRootNode> buildAST();
+    // Parses the whole input, recovering from syntax errors. With errors
+    // the tree is partial: statements and declarations that failed are
+    // left out, and a compound statement whose body failed has a null body.
+    ASTRootNode* buildAST();
+
+    const std::vector<SyntaxError>& syntaxErrors() const { return errors; }
+
+    // Writes the first count syntax errors
+    void writeErrors(OutputBuffer& out, size_t count) const;
 };
@@ -1,8 +1,6 @@
 #include "ASTNodes.h"
-#include <iostream>
-#include <string>
 
-Node::Node(int line, int column) : line(line), column(column) {}
+Node::Node(NodeKind nodeKind, int line, int column) : line(line), column(column), nodeKind(nodeKind) {}
 
 ASTNodeType* ASTNodeType::voidType = new ASTNodeType(ASTNodeType::Void);
 ASTNodeType* ASTNodeType::intType = new ASTNodeType(ASTNodeType::Int);
@@ -13,7 +11,7 @@ ASTNodeType* ASTNodeType::nullType = new ASTNodeType(ASTNodeType::Null);
 ASTNodeType* ASTNodeType::errorType = new ASTNodeType(ASTNodeType::Error);
 
 ASTNodeType::ASTNodeType(TypeKind kind, int line, int column) 
-    : Node(line, column), kind(kind) {}
+    : Node(NodeKind::Type, line, column), kind(kind) {}
 
 bool ASTNodeType::isError() const { return kind == Error; }
 bool ASTNodeType::isVoid() const { return kind == Void; }
@@ -30,6 +28,10 @@ bool ASTNodeType::isAssignableTo(const ASTNodeType* other) const {
 }
 
 const char* ASTNodeType::typeName() const {
+    return kindName(kind);
+}
+
+const char* ASTNodeType::kindName(TypeKind kind) {
     switch (kind) {
         case Void: return "void";
         case Int: return "int";
@@ -42,169 +44,134 @@ const char* ASTNodeType::typeName() const {
     }
 }
 
-void ASTNodeType::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "Type: " << typeName() << std::endl;
-}
-
-Identifier::Identifier(const std::string& name, int line, int column)
-    : Node(line, column), name(name) {}
-
-void Identifier::print(int indent) const {
-    std::cout << "  " << line << std::string(indent, ' ') << "Identifier: " << name << std::endl;
-}
+Identifier::Identifier(uint32_t symbol, const TextRef& name, int line, int column)
+    : Node(NodeKind::Identifier, line, column), symbol(symbol), name(name) {}
 
 IntLiteral::IntLiteral(int value, int line, int column)
-    : LiteralExpr(line, column), value(value) {}
+    : LiteralExpr(NodeKind::IntLiteral, line, column), value(value) {}
 
 ASTNodeType* IntLiteral::getType() const { 
     return ASTNodeType::intType; 
 }
 
-void IntLiteral::print(int indent) const {
-    std::cout << "  " << line << std::string(indent, ' ') << "IntConstant: " << value << std::endl;
-}
-
 DoubleLiteral::DoubleLiteral(double value, int line, int column)
-    : LiteralExpr(line, column), value(value) {}
+    : LiteralExpr(NodeKind::DoubleLiteral, line, column), value(value) {}
 
 ASTNodeType* DoubleLiteral::getType() const { 
     return ASTNodeType::doubleType; 
 }
 
-void DoubleLiteral::print(int indent) const {
-    std::cout << "  " << line << std::string(indent, ' ') << "DoubleConstant: " << value << std::endl;
-}
-
 BoolLiteral::BoolLiteral(bool value, int line, int column)
-    : LiteralExpr(line, column), value(value) {}
+    : LiteralExpr(NodeKind::BoolLiteral, line, column), value(value) {}
 
 ASTNodeType* BoolLiteral::getType() const { 
     return ASTNodeType::boolType; 
 }
 
-void BoolLiteral::print(int indent) const {
-    std::cout << "  " << line << std::string(indent, ' ') << "BoolConstant: " << (value ? "true" : "false") << std::endl;
-}
-
-StringLiteral::StringLiteral(const std::string& value, int line, int column)
-    : LiteralExpr(line, column), value(value) {}
+StringLiteral::StringLiteral(const TextRef& value, int line, int column)
+    : LiteralExpr(NodeKind::StringLiteral, line, column), value(value) {}
 
 ASTNodeType* StringLiteral::getType() const { 
     return ASTNodeType::stringType; 
 }
 
-void StringLiteral::print(int indent) const {
-    if (isArgument) {
-        std::cout << "  " << line << "         (args) StringConstant: " << value << std::endl;
-    } else {
-        std::cout << std::string(indent, ' ') << "StringConstant: " << value << std::endl;
-    }
-}
-
 NullLiteral::NullLiteral(int line, int column)
-    : LiteralExpr(line, column) {}
+    : LiteralExpr(NodeKind::NullLiteral, line, column) {}
 
 ASTNodeType* NullLiteral::getType() const { 
     return ASTNodeType::nullType; 
 }
 
-void NullLiteral::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "NullLiteral" << std::endl;
-}
-
-VarExpr::VarExpr(std::shared_ptr<Identifier> id, int line, int column, ASTNodeType* type)
-    : Expr(line, column), id(id), varType(type) {}
+VarExpr::VarExpr(Identifier* id, int line, int column, ASTNodeType* type)
+    : Expr(NodeKind::VarExpr, line, column), id(id), varType(type) {}
 
 ASTNodeType* VarExpr::getType() const { 
     return varType; 
 }
 
-void VarExpr::print(int indent) const {
-    if (isArgument) {
-        std::cout << "  " << line << std::string(indent, ' ') << "(actuals) FieldAccess: " << std::endl;
-    } else {
-        std::cout << "  " << line << std::string(indent, ' ') << "FieldAccess: " << std::endl;
-    }
-    id->print(indent + 3);
-}
-
-BinaryExpr::BinaryExpr(BinaryOp op, std::shared_ptr<Expr> left, 
-                      std::shared_ptr<Expr> right, int line, int column)
-    : Expr(line, column), op(op), left(left), right(right) {}
+BinaryExpr::BinaryExpr(BinaryOp op, Expr* left, 
+                      Expr* right, int line, int column)
+    : Expr(NodeKind::BinaryExpr, line, column), op(op), left(left), right(right) {}
 
+// Before the SemanticChecker has annotated it, every call walks the whole subtree
 ASTNodeType* BinaryExpr::getType() const {
-    ASTNodeType* leftType = left->getType();
-    ASTNodeType* rightType = right->getType();
+    if (annotatedType) {
+        return annotatedType;
+    }
+    return resultType(op, left->getType(), right->getType());
+}
 
+// Operands must be numeric and of the same type for arithmetic and
+// relational operators, comparable for equality and bool for && and ||
+ASTNodeType* BinaryExpr::resultType(BinaryOp op, ASTNodeType* leftType, ASTNodeType* rightType) {
     if (leftType->isError() || rightType->isError()) {
         return ASTNodeType::errorType;
     }
 
-    if (leftType->isNumeric() && rightType->isNumeric()) {
-        if (leftType->kind == ASTNodeType::Double || 
-            rightType->kind == ASTNodeType::Double) {
-            return ASTNodeType::doubleType;
-        }
-        return ASTNodeType::intType;
-    }
-
-    if (op == And || op == Or) {
-        return ASTNodeType::boolType;
-    }
-
-    if (op == Equal || op == NotEqual || 
-        op == Less || op == LessEqual || 
-        op == Greater || op == GreaterEqual) {
-        return ASTNodeType::boolType;
+    switch (op) {
+        case Plus: case Minus: case Multiply: case Divide: case Modulo:
+            return leftType->isNumeric() && leftType->isEquivalentTo(rightType)
+                ? leftType : ASTNodeType::errorType;
+        case Less: case LessEqual: case Greater: case GreaterEqual:
+            return leftType->isNumeric() && leftType->isEquivalentTo(rightType)
+                ? ASTNodeType::boolType : ASTNodeType::errorType;
+        case Equal: case NotEqual:
+            return !leftType->isVoid() &&
+                (leftType->isAssignableTo(rightType) || rightType->isAssignableTo(leftType))
+                ? ASTNodeType::boolType : ASTNodeType::errorType;
+        case And: case Or:
+            return leftType->kind == ASTNodeType::Bool && rightType->kind == ASTNodeType::Bool
+                ? ASTNodeType::boolType : ASTNodeType::errorType;
+        default:
+            return ASTNodeType::errorType;
     }
-
-    return ASTNodeType::errorType;
 }
 
-void BinaryExpr::print(int indent) const {
-    std::string exprType;
+const char* BinaryExpr::kindName(BinaryOp op) {
     switch (op) {
         case Plus: case Minus: case Multiply: case Divide: case Modulo:
-            exprType = "ArithmeticExpr"; break;
+            return "ArithmeticExpr";
         case Less: case LessEqual: case Greater: case GreaterEqual:
-            exprType = "RelationalExpr"; break;
+            return "RelationalExpr";
         case Equal: case NotEqual:
-            exprType = "EqualityExpr"; break;
+            return "EqualityExpr";
         case And: case Or:
-            exprType = "LogicalExpr"; break;
-        default: exprType = "BinaryExpr";
+            return "LogicalExpr";
+        default:
+            return "BinaryExpr";
     }
-    
-    std::cout << "  " << line << std::string(indent, ' ') << exprType << ": " << std::endl;
-    left->print(indent + 3);
-    
-    std::cout << "  " << line << std::string(indent, ' ') << "  Operator: ";
-    switch(op) { 
-        case Plus: std::cout << "+"; break;
-        case Minus: std::cout << "-"; break;
-        case Multiply: std::cout << "*"; break;
-        case Divide: std::cout << "/"; break;
-        case Modulo: std::cout << "%"; break;
-        case Less: std::cout << "<"; break;
-        case LessEqual: std::cout << "<="; break;
-        case Greater: std::cout << ">"; break;
-        case GreaterEqual: std::cout << ">="; break;
-        case Equal: std::cout << "=="; break;
-        case NotEqual: std::cout << "!="; break;
-        case And: std::cout << "&&"; break;
-        case Or: std::cout << "||"; break;
-        default: std::cout << "unknown_op"; break;
+}
+
+const char* BinaryExpr::operatorText(BinaryOp op) {
+    switch (op) {
+        case Plus: return "+";
+        case Minus: return "-";
+        case Multiply: return "*";
+        case Divide: return "/";
+        case Modulo: return "%";
+        case Less: return "<";
+        case LessEqual: return "<=";
+        case Greater: return ">";
+        case GreaterEqual: return ">=";
+        case Equal: return "==";
+        case NotEqual: return "!=";
+        case And: return "&&";
+        case Or: return "||";
+        default: return "unknown_op";
     }
-    std::cout << std::endl;
-    
-    right->print(indent + 3);
 }
 
-UnaryExpr::UnaryExpr(UnaryOp op, std::shared_ptr<Expr> expr, int line, int column)
-    : Expr(line, column), op(op), expr(expr) {}
+UnaryExpr::UnaryExpr(UnaryOp op, Expr* expr, int line, int column)
+    : Expr(NodeKind::UnaryExpr, line, column), op(op), expr(expr) {}
 
 ASTNodeType* UnaryExpr::getType() const {
-    ASTNodeType* exprType = expr->getType();
+    if (annotatedType) {
+        return annotatedType;
+    }
+    return resultType(op, expr->getType());
+}
+
+ASTNodeType* UnaryExpr::resultType(UnaryOp op, ASTNodeType* exprType) {
     if (exprType->isError()) {
         return ASTNodeType::errorType;
     }
@@ -220,17 +187,10 @@ ASTNodeType* UnaryExpr::getType() const {
     }
 }
 
-void UnaryExpr::print(int indent) const {
-    std::cout << "  " << line << std::string(indent, ' ') << "LogicalExpr: " << std::endl;
-    std::cout << "  " << line << std::string(indent, ' ') << "  Operator: " 
-              << (op == Minus ? "-" : "!") << std::endl;
-    expr->print(indent + 3);
-}
-
-CallExpr::CallExpr(std::shared_ptr<Identifier> id, int line, int column)
-    : Expr(line, column), id(id), returnType(nullptr) {}
+CallExpr::CallExpr(Arena& arena, Identifier* id, int line, int column)
+    : Expr(NodeKind::CallExpr, line, column), id(id), args(arena), returnType(nullptr) {}
 
-void CallExpr::addArg(std::shared_ptr<Expr> arg) {
+void CallExpr::addArg(Expr* arg) {
     arg->setIsArgument(true);
     args.push_back(arg);
 }
@@ -239,205 +199,82 @@ ASTNodeType* CallExpr::getType() const {
     return returnType ? returnType : ASTNodeType::errorType; 
 }
 
-void CallExpr::print(int indent) const {
-    if (isArgument) {
-        std::cout <<  "  " << line << std::string(indent, ' ') << "(args) Call:" << std::endl;
-    } else {
-        std::cout <<  "  " << line << std::string(indent, ' ') << "Call:" << std::endl;
-    }
-    id->print(indent+3);
-    for (const auto& arg : args) {
-        arg->print(indent + 3);
-    }
-}
-
-AssignExpr::AssignExpr(std::shared_ptr<Expr> left, 
-                      std::shared_ptr<Expr> right, int line, int column)
-    : Expr(line, column), left(left), right(right) {}
+AssignExpr::AssignExpr(Expr* left, 
+                      Expr* right, int line, int column)
+    : Expr(NodeKind::AssignExpr, line, column), left(left), right(right) {}
 
 ASTNodeType* AssignExpr::getType() const { 
-    return left->getType(); 
+    return annotatedType ? annotatedType : left->getType(); 
 }
 
-void AssignExpr::print(int indent) const {
-    std::cout << "  " << line << std::string(indent, ' ') << "AssignExpr: " << std::endl;
-    left->print(indent + 3);
-    std::cout << "  " << line << std::string(indent, ' ') << "   Operator: =" << std::endl;
-    right->print(indent + 3);
-}
-
-ExprStmt::ExprStmt(std::shared_ptr<Expr> expr, int line, int column)
-    : Stmt(line, column), expr(expr) {}
+ExprStmt::ExprStmt(Expr* expr, int line, int column)
+    : Stmt(NodeKind::ExprStmt, line, column), expr(expr) {}
 
-void ExprStmt::print(int indent) const {
-    expr->print(indent);
-}
+BlockStmt::BlockStmt(Arena& arena, int line, int column) : Stmt(NodeKind::BlockStmt, line, column), stmts(arena) {}
 
-BlockStmt::BlockStmt(int line, int column) : Stmt(line, column) {}
-
-void BlockStmt::addStmt(std::shared_ptr<Stmt> stmt) {
+void BlockStmt::addStmt(Stmt* stmt) {
     stmts.push_back(stmt);
 }
 
-void BlockStmt::print(int indent) const {
-    std::cout << std::string(indent+3, ' ') << "(body) StmtBlock: " << std::endl;
-    for (const auto& stmt : stmts) {
-        stmt->print(indent + 3);
-    }
-}
-
-IfStmt::IfStmt(std::shared_ptr<Expr> cond, std::shared_ptr<Stmt> thenStmt,
-               std::shared_ptr<Stmt> elseStmt, int line, int column)
-    : Stmt(line, column), cond(cond), thenStmt(thenStmt), elseStmt(elseStmt) {}
-
-void IfStmt::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "IfStmt: " << std::endl;
-    std::cout << std::string(indent, ' ') << "  Condition: " << std::endl;
-    cond->print(indent + 4);
-    std::cout << std::string(indent, ' ') << "  Then: " << std::endl;
-    thenStmt->print(indent + 4);
-    if (elseStmt) {
-        std::cout << std::string(indent, ' ') << "  Else: " << std::endl;
-        elseStmt->print(indent + 4);
-    }
-}
-
-WhileStmt::WhileStmt(std::shared_ptr<Expr> cond, 
-                     std::shared_ptr<Stmt> body, int line, int column)
-    : Stmt(line, column), cond(cond), body(body) {}
+IfStmt::IfStmt(Expr* cond, Stmt* thenStmt,
+               Stmt* elseStmt, int line, int column)
+    : Stmt(NodeKind::IfStmt, line, column), cond(cond), thenStmt(thenStmt), elseStmt(elseStmt) {}
 
-void WhileStmt::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "WhileStmt: " << std::endl;
-    std::cout << std::string(indent, ' ') << "  Condition: " << std::endl;
-    cond->print(indent + 4);
-    std::cout << std::string(indent, ' ') << "  Body: " << std::endl;
-    body->print(indent + 4);
-}
+WhileStmt::WhileStmt(Expr* cond, 
+                     Stmt* body, int line, int column)
+    : Stmt(NodeKind::WhileStmt, line, column), cond(cond), body(body) {}
 
-ForStmt::ForStmt(std::shared_ptr<Expr> init, std::shared_ptr<Expr> cond,
-                 std::shared_ptr<Expr> update, std::shared_ptr<Stmt> body,
+ForStmt::ForStmt(Expr* init, Expr* cond,
+                 Expr* update, Stmt* body,
                  int line, int column)
-    : Stmt(line, column), init(init), cond(cond), 
+    : Stmt(NodeKind::ForStmt, line, column), init(init), cond(cond), 
       update(update), body(body) {}
 
-void ForStmt::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "ForStmt: " << std::endl;
-    if (init) {
-        std::cout << std::string(indent, ' ') << "  Init: " << std::endl;
-        init->print(indent + 4);
-    }
-    if (cond) {
-        std::cout << std::string(indent, ' ') << "  Condition: " << std::endl;
-        cond->print(indent + 4);
-    }
-    if (update) {
-        std::cout << std::string(indent, ' ') << "  Update: " << std::endl;
-        update->print(indent + 4);
-    }
-    std::cout << std::string(indent, ' ') << "  Body: " << std::endl;
-    body->print(indent + 4);
-}
+ReturnStmt::ReturnStmt(Expr* expr, int line, int column)
+    : Stmt(NodeKind::ReturnStmt, line, column), expr(expr) {}
 
-ReturnStmt::ReturnStmt(std::shared_ptr<Expr> expr, int line, int column)
-    : Stmt(line, column), expr(expr) {}
+BreakStmt::BreakStmt(int line, int column) : Stmt(NodeKind::BreakStmt, line, column) {}
 
-void ReturnStmt::print(int indent) const {
-    std::cout << "  " << line << std::string(indent, ' ') << "ReturnStmt: " << std::endl;
-    if (expr) {
-        expr->print(indent + 3);
-    }
-}
-
-BreakStmt::BreakStmt(int line, int column) : Stmt(line, column) {}
-
-void BreakStmt::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "BreakStmt" << std::endl;
-}
+PrintStmt::PrintStmt(Arena& arena, int line, int column) : Stmt(NodeKind::PrintStmt, line, column), args(arena) {}
 
-PrintStmt::PrintStmt(int line, int column) : Stmt(line, column) {}
-
-void PrintStmt::addArg(std::shared_ptr<Expr> arg) {
+void PrintStmt::addArg(Expr* arg) {
     arg->setIsArgument(true);
     args.push_back(arg);
 }
 
-void PrintStmt::print(int indent) const {
-    std::cout << std::string(indent+4, ' ') << "PrintStmt: " << std::endl;
-    for (const auto& arg : args) {
-        arg->print(indent + 3);
-    }
-}
-
-ReadIntegerExpr::ReadIntegerExpr(int line, int column) : Expr(line, column) {}
+ReadIntegerExpr::ReadIntegerExpr(int line, int column) : Expr(NodeKind::ReadIntegerExpr, line, column) {}
 
 ASTNodeType* ReadIntegerExpr::getType() const { 
     return ASTNodeType::intType; 
 }
 
-void ReadIntegerExpr::print(int indent) const {
-    std::cout << "  " << line << std::string(indent, ' ') << "ReadIntegerExpr: " << std::endl;
-}
+ReadLineExpr::ReadLineExpr(int line, int column) : Expr(NodeKind::ReadLineExpr, line, column) {}
 
-VarDecl::VarDecl(ASTNodeType* type, std::shared_ptr<Identifier> id,
-                 std::shared_ptr<Expr> init, int line, int column)
-    : Decl(line, column), type(type), id(id), init(init) {}
-
-void VarDecl::print(int indent) const {
-    std::cout << "  " << line << std::string(indent, ' ') << "VarDecl: " << std::endl;
-    type->print(indent + 6);
-    id->print(indent + 3);
-    if (init) {
-        std::cout << "  " << line << std::string(indent-3, ' ') << "   Init: " << std::endl;
-        init->print(indent + 4);
-    }
+ASTNodeType* ReadLineExpr::getType() const { 
+    return ASTNodeType::stringType; 
 }
 
-VarDeclStmt::VarDeclStmt(std::shared_ptr<VarDecl> varDecl, int line, int column)
-    : Stmt(line, column), varDecl(varDecl) {}
+VarDecl::VarDecl(ASTNodeType* type, Identifier* id,
+                 Expr* init, int line, int column)
+    : Decl(NodeKind::VarDecl, line, column), type(type), id(id), init(init) {}
 
-void VarDeclStmt::print(int indent) const {
-    varDecl->print(indent);
-}
+VarDeclStmt::VarDeclStmt(VarDecl* varDecl, int line, int column)
+    : Stmt(NodeKind::VarDeclStmt, line, column), varDecl(varDecl) {}
 
-FunctionDecl::FunctionDecl(ASTNodeType* returnType, 
-                          std::shared_ptr<Identifier> id, int line, int column)
-    : Decl(line, column), returnType(returnType), id(id) {}
+FunctionDecl::FunctionDecl(Arena& arena, ASTNodeType* returnType, 
+                          Identifier* id, int line, int column)
+    : Decl(NodeKind::FunctionDecl, line, column), returnType(returnType), id(id), formals(arena), body(nullptr) {}
 
-void FunctionDecl::addFormal(std::shared_ptr<VarDecl> formal) {
+void FunctionDecl::addFormal(VarDecl* formal) {
     formals.push_back(formal);
 }
 
-void FunctionDecl::setBody(std::shared_ptr<BlockStmt> functionBody) {
+void FunctionDecl::setBody(BlockStmt* functionBody) {
     body = functionBody;
 }
 
-void FunctionDecl::print(int indent) const {
-    std::cout << "  " << line << std::string(indent, ' ') <<  "FnDecl: " << std::endl;
-    std::cout << std::string(indent+6, ' ') << "(return type) Type: " 
-              << returnType->typeName() << std::endl;
-    id->print(indent+3);
-    
-    for (const auto& formal : formals) {
-        std::cout << "  " << formal->line  << std::string(indent+3, ' ')
-                  << "(formals) VarDecl: " << std::endl;
-        formal->type->print(indent + 9);
-        formal->id->print(indent + 6);
-    }
-
-    if (body) {
-        body->print(indent+3);
-    }
-}
-
-ASTRootNode::ASTRootNode(int line, int column) : Node(line, column) {}
+ASTRootNode::ASTRootNode(Arena& arena, int line, int column) : Node(NodeKind::Program, line, column), decls(arena) {}
 
-void ASTRootNode::addDecl(std::shared_ptr<Decl> decl) {
+void ASTRootNode::addDecl(Decl* decl) {
     decls.push_back(decl);
 }
-
-void ASTRootNode::print(int indent) const {
-    std::cout << std::endl << "   Program: " << std::endl;
-    for (const auto& decl : decls) {
-        decl->print(indent + 3);
-    }
-}
\ No newline at end of file
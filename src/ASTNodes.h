@@ -1,33 +1,81 @@
 #pragma once
 
 #include <string>
-#include <vector>
-#include <memory>
 #include <iostream>
 #include "Token.h"
+#include "Arena.h"
 
 // Forward declarations
 class ASTNodeType;
 class Identifier;
 
+// Concrete class of a Node, for switch dispatch (see ASTVisitor.h) and
+// checked downcasts without RTTI
+enum class NodeKind : unsigned char {
+    Type,
+    Identifier,
+    // Expressions, IntLiteral to ReadLineExpr
+    IntLiteral,
+    DoubleLiteral,
+    BoolLiteral,
+    StringLiteral,
+    NullLiteral,
+    VarExpr,
+    BinaryExpr,
+    UnaryExpr,
+    CallExpr,
+    AssignExpr,
+    ReadIntegerExpr,
+    ReadLineExpr,
+    ExprStmt,
+    BlockStmt,
+    IfStmt,
+    WhileStmt,
+    ForStmt,
+    ReturnStmt,
+    BreakStmt,
+    PrintStmt,
+    VarDeclStmt,
+    VarDecl,
+    FunctionDecl,
+    Program
+};
+
 class Node {
 public:
     int line;
     int column;
+    NodeKind nodeKind;
 
-    Node(int line = 0, int column = 0);
-    virtual ~Node() = default;
-    virtual void print(int indent = 0) const = 0;
+    // Nodes live in an Arena, which never runs destructors, so there is no
+    // virtual destructor and nodes must not own memory outside the arena
+    Node(NodeKind nodeKind, int line = 0, int column = 0);
 };
 
 class Expr : public Node {
 protected:
     bool isArgument = false;
+    // Set by annotate(), after which getType() is O(1) for every kind
+    ASTNodeType* annotatedType = nullptr;
 public:
-    Expr(int line, int column) : Node(line, column) {}
+    // Last character of the expression, set by the parser
+    int endLine = 0;
+    int endColumn = 0;
+
+    Expr(NodeKind nodeKind, int line, int column) : Node(nodeKind, line, column) {}
     virtual ASTNodeType* getType() const = 0;
     void setIsArgument(bool isArg) { isArgument = isArg; }
     bool getIsArgument() const { return isArgument; }
+
+    // Computes and stores the type from the children's, which have to be
+    // annotated already; the SemanticChecker annotates the whole tree
+    void annotate() {
+        annotatedType = nullptr;
+        annotatedType = getType();
+    }
+
+    // Stores a type decided elsewhere, by the SemanticChecker
+    void annotate(ASTNodeType* type) { annotatedType = type; }
 };
 
 class ASTNodeType : public Node {
@@ -45,7 +93,7 @@ public:
     bool isEquivalentTo(const ASTNodeType* other) const;
     bool isAssignableTo(const ASTNodeType* other) const;
     const char* typeName() const;  // Add this line
-    void print(int indent = 0) const override;
+    static const char* kindName(TypeKind kind);
 
     static ASTNodeType* voidType;
     static ASTNodeType* intType;
@@ -58,9 +106,9 @@ public:
 
 class Identifier : public Node {
 public:
-    std::string name;
-    Identifier(const std::string& name, int line = 0, int column = 0);
-    void print(int indent = 0) const override;
+    uint32_t symbol; // ID from the Scanner's Interner
+    TextRef name;    // Points into the source
+    Identifier(uint32_t symbol, const TextRef& name, int line = 0, int column = 0);
 };
 
 class LiteralExpr : public Expr {
@@ -73,7 +121,6 @@ public:
     int value;
     IntLiteral(int value, int line = 0, int column = 0);
     ASTNodeType* getType() const override;
-    void print(int indent = 0) const override;
 };
 
 class DoubleLiteral : public LiteralExpr {
@@ -81,7 +128,6 @@ public:
     double value;
     DoubleLiteral(double value, int line = 0, int column = 0);
     ASTNodeType* getType() const override;
-    void print(int indent = 0) const override;
 };
 
 class BoolLiteral : public LiteralExpr {
@@ -89,32 +135,28 @@ public:
     bool value;
     BoolLiteral(bool value, int line = 0, int column = 0);
     ASTNodeType* getType() const override;
-    void print(int indent = 0) const override;
 };
 
 class StringLiteral : public LiteralExpr {
 public:
-    std::string value;
-    StringLiteral(const std::string& value, int line = 0, int column = 0);
+    TextRef value; // Points into the source
+    StringLiteral(const TextRef& value, int line = 0, int column = 0);
     ASTNodeType* getType() const override;
-    void print(int indent = 0) const override;
 };
 
 class NullLiteral : public LiteralExpr {
 public:
     NullLiteral(int line = 0, int column = 0);
     ASTNodeType* getType() const override;
-    void print(int indent = 0) const override;
 };
 
 class VarExpr : public Expr {
 public:
-    std::shared_ptr<Identifier> id;
+    Identifier* id;
     ASTNodeType* varType;
 
-    VarExpr(std::shared_ptr<Identifier> id, int line = 0, int column = 0, ASTNodeType* type = ASTNodeType::errorType);
+    VarExpr(Identifier* id, int line = 0, int column = 0, ASTNodeType* type = ASTNodeType::errorType);
     ASTNodeType* getType() const override;
-    void print(int indent = 0) const override;
 };
 
 class BinaryExpr : public Expr {
@@ -126,13 +168,17 @@ public:
     };
 
     BinaryOp op;
-    std::shared_ptr<Expr> left;
-    std::shared_ptr<Expr> right;
+    Expr* left;
+    Expr* right;
+    int opLine = 0;   // Position of the operator
+    int opColumn = 0;
 
-    BinaryExpr(BinaryOp op, std::shared_ptr<Expr> left, std::shared_ptr<Expr> right,
+    BinaryExpr(BinaryOp op, Expr* left, Expr* right,
               int line = 0, int column = 0);
     ASTNodeType* getType() const override;
-    void print(int indent = 0) const override;
+    static ASTNodeType* resultType(BinaryOp op, ASTNodeType* leftType, ASTNodeType* rightType);
+    static const char* kindName(BinaryOp op);     // ArithmeticExpr, RelationalExpr...
+    static const char* operatorText(BinaryOp op); // As written in the source
 };
 
 class UnaryExpr : public Expr {
@@ -140,34 +186,34 @@ public:
     enum UnaryOp { Minus, Not };
     
     UnaryOp op;
-    std::shared_ptr<Expr> expr;
+    Expr* expr;
 
-    UnaryExpr(UnaryOp op, std::shared_ptr<Expr> expr, int line = 0, int column = 0);
+    UnaryExpr(UnaryOp op, Expr* expr, int line = 0, int column = 0);
     ASTNodeType* getType() const override;
-    void print(int indent = 0) const override;
+    static ASTNodeType* resultType(UnaryOp op, ASTNodeType* exprType);
 };
 
 class CallExpr : public Expr {
 public:
-    std::shared_ptr<Identifier> id;
-    std::vector<std::shared_ptr<Expr>> args;
+    Identifier* id;
+    ArenaList<Expr*> args;
     ASTNodeType* returnType;
 
-    CallExpr(std::shared_ptr<Identifier> id, int line = 0, int column = 0);
-    void addArg(std::shared_ptr<Expr> arg);
+    CallExpr(Arena& arena, Identifier* id, int line = 0, int column = 0);
+    void addArg(Expr* arg);
     ASTNodeType* getType() const override;
-    void print(int indent = 0) const override;
 };
 
 class AssignExpr : public Expr {
 public:
-    std::shared_ptr<Expr> left;
-    std::shared_ptr<Expr> right;
+    Expr* left;
+    Expr* right;
+    int opLine = 0;   // Position of the '='
+    int opColumn = 0;
 
-    AssignExpr(std::shared_ptr<Expr> left, std::shared_ptr<Expr> right,
+    AssignExpr(Expr* left, Expr* right,
               int line = 0, int column = 0);
     ASTNodeType* getType() const override;
-    void print(int indent = 0) const override;
 };
 
 class Stmt : public Node {
@@ -177,83 +223,80 @@ public:
 
 class ExprStmt : public Stmt {
 public:
-    std::shared_ptr<Expr> expr;
+    Expr* expr;
 
-    ExprStmt(std::shared_ptr<Expr> expr, int line = 0, int column = 0);
-    void print(int indent = 0) const override;
+    ExprStmt(Expr* expr, int line = 0, int column = 0);
 };
 
 class BlockStmt : public Stmt {
 public:
-    std::vector<std::shared_ptr<Stmt>> stmts;
+    ArenaList<Stmt*> stmts;
 
-    BlockStmt(int line = 0, int column = 0);
-    void addStmt(std::shared_ptr<Stmt> stmt);
-    void print(int indent = 0) const override;
+    BlockStmt(Arena& arena, int line = 0, int column = 0);
+    void addStmt(Stmt* stmt);
 };
 
 class IfStmt : public Stmt {
 public:
-    std::shared_ptr<Expr> cond;
-    std::shared_ptr<Stmt> thenStmt;
-    std::shared_ptr<Stmt> elseStmt;
+    Expr* cond;
+    Stmt* thenStmt;
+    Stmt* elseStmt;
 
-    IfStmt(std::shared_ptr<Expr> cond, std::shared_ptr<Stmt> thenStmt,
-           std::shared_ptr<Stmt> elseStmt = nullptr, int line = 0, int column = 0);
-    void print(int indent = 0) const override;
+    IfStmt(Expr* cond, Stmt* thenStmt,
+           Stmt* elseStmt = nullptr, int line = 0, int column = 0);
 };
 
 class WhileStmt : public Stmt {
 public:
-    std::shared_ptr<Expr> cond;
-    std::shared_ptr<Stmt> body;
+    Expr* cond;
+    Stmt* body;
 
-    WhileStmt(std::shared_ptr<Expr> cond, std::shared_ptr<Stmt> body,
+    WhileStmt(Expr* cond, Stmt* body,
              int line = 0, int column = 0);
-    void print(int indent = 0) const override;
 };
 
 class ForStmt : public Stmt {
 public:
-    std::shared_ptr<Expr> init;
-    std::shared_ptr<Expr> cond;
-    std::shared_ptr<Expr> update;
-    std::shared_ptr<Stmt> body;
+    Expr* init;
+    Expr* cond;
+    Expr* update;
+    Stmt* body;
 
-    ForStmt(std::shared_ptr<Expr> init, std::shared_ptr<Expr> cond,
-            std::shared_ptr<Expr> update, std::shared_ptr<Stmt> body,
+    ForStmt(Expr* init, Expr* cond,
+            Expr* update, Stmt* body,
             int line = 0, int column = 0);
-    void print(int indent = 0) const override;
 };
 
 class ReturnStmt : public Stmt {
 public:
-    std::shared_ptr<Expr> expr;
+    Expr* expr;
 
-    ReturnStmt(std::shared_ptr<Expr> expr = nullptr, int line = 0, int column = 0);
-    void print(int indent = 0) const override;
+    ReturnStmt(Expr* expr = nullptr, int line = 0, int column = 0);
 };
 
 class BreakStmt : public Stmt {
 public:
     BreakStmt(int line = 0, int column = 0);
-    void print(int indent = 0) const override;
 };
 
 class PrintStmt : public Stmt {
 public:
-    std::vector<std::shared_ptr<Expr>> args;
+    ArenaList<Expr*> args;
 
-    PrintStmt(int line = 0, int column = 0);
-    void addArg(std::shared_ptr<Expr> arg);
-    void print(int indent = 0) const override;
+    PrintStmt(Arena& arena, int line = 0, int column = 0);
+    void addArg(Expr* arg);
 };
 
 class ReadIntegerExpr : public Expr {
 public:
     ReadIntegerExpr(int line = 0, int column = 0);
     ASTNodeType* getType() const override;
-    void print(int indent) const override;
+};
+
+class ReadLineExpr : public Expr {
+public:
+    ReadLineExpr(int line = 0, int column = 0);
+    ASTNodeType* getType() const override;
 };
 
 class Decl : public Node {
@@ -265,41 +308,37 @@ public:
 class VarDecl : public Decl {
 public:
     ASTNodeType* type;
-    std::shared_ptr<Identifier> id;
-    std::shared_ptr<Expr> init;
+    Identifier* id;
+    Expr* init;
 
-    VarDecl(ASTNodeType* type, std::shared_ptr<Identifier> id,
-            std::shared_ptr<Expr> init = nullptr, int line = 0, int column = 0);
-    void print(int indent = 0) const override;
+    VarDecl(ASTNodeType* type, Identifier* id,
+            Expr* init = nullptr, int line = 0, int column = 0);
 };
 
 // Var declaration that doesn't include assignment
 class VarDeclStmt : public Stmt {
 public:
-    std::shared_ptr<VarDecl> varDecl;
-    VarDeclStmt(std::shared_ptr<VarDecl> varDecl, int line = 0, int column = 0);
-    void print(int indent = 0) const override;
+    VarDecl* varDecl;
+    VarDeclStmt(VarDecl* varDecl, int line = 0, int column = 0);
 };
 
 class FunctionDecl : public Decl {
 public:
     ASTNodeType* returnType;
-    std::shared_ptr<Identifier> id;
-    std::vector<std::shared_ptr<VarDecl>> formals;
-    std::shared_ptr<BlockStmt> body;
+    Identifier* id;
+    ArenaList<VarDecl*> formals;
+    BlockStmt* body;
 
-    FunctionDecl(ASTNodeType* returnType, std::shared_ptr<Identifier> id,
+    FunctionDecl(Arena& arena, ASTNodeType* returnType, Identifier* id,
                  int line = 0, int column = 0);
-    void addFormal(std::shared_ptr<VarDecl> formal);
-    void setBody(std::shared_ptr<BlockStmt> functionBody);
-    void print(int indent = 0) const override;
+    void addFormal(VarDecl* formal);
+    void setBody(BlockStmt* functionBody);
 };
 
 class ASTRootNode : public Node {
 public:
-    std::vector<std::shared_ptr<Decl>> decls;
+    ArenaList<Decl*> decls;
 
-    ASTRootNode(int line = 0, int column = 0);
-    void addDecl(std::shared_ptr<Decl> decl);
-    void print(int indent = 0) const override;
+    ASTRootNode(Arena& arena, int line = 0, int column = 0);
+    void addDecl(Decl* decl);
 };
\ No newline at end of file
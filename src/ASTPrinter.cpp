@@ -0,0 +1,276 @@
+#include "ASTPrinter.h"
+#include <cstdio>
+
+void ASTPrinter::print(ASTRootNode* root) {
+    schedule(root, 0);
+    run();
+}
+
+void ASTPrinter::printLeaf(Node* node, int nodeIndent) {
+    int saved = task.indent;
+    task.indent = nodeIndent;
+    visit(node);
+    task.indent = saved;
+}
+
+void ASTPrinter::lead(int line, int extra) {
+    out.write("  ");
+    out.writeInt(line);
+    out.spaces(task.indent + extra);
+}
+
+void ASTPrinter::visitType(ASTNodeType* type) {
+    out.spaces(task.indent);
+    out.write("Type: ");
+    out.write(type->typeName());
+    out.put('\n');
+}
+
+void ASTPrinter::visitIdentifier(Identifier* id) {
+    lead(id->line);
+    out.write("Identifier: ");
+    out.write(id->name);
+    out.put('\n');
+}
+
+void ASTPrinter::visitIntLiteral(IntLiteral* literal) {
+    lead(literal->line);
+    out.write("IntConstant: ");
+    out.writeInt(literal->value);
+    out.put('\n');
+}
+
+void ASTPrinter::visitDoubleLiteral(DoubleLiteral* literal) {
+    // Default ostream formatting, which is %g
+    char digits[32];
+    int length = std::snprintf(digits, sizeof(digits), "%g", literal->value);
+    lead(literal->line);
+    out.write("DoubleConstant: ");
+    out.write(digits, length);
+    out.put('\n');
+}
+
+void ASTPrinter::visitBoolLiteral(BoolLiteral* literal) {
+    lead(literal->line);
+    out.write(literal->value ? "BoolConstant: true\n" : "BoolConstant: false\n");
+}
+
+void ASTPrinter::visitStringLiteral(StringLiteral* literal) {
+    if (literal->getIsArgument()) {
+        out.write("  ");
+        out.writeInt(literal->line);
+        out.write("         (args) StringConstant: ");
+    } else {
+        out.spaces(task.indent);
+        out.write("StringConstant: ");
+    }
+    out.write(literal->value);
+    out.put('\n');
+}
+
+void ASTPrinter::visitNullLiteral(NullLiteral*) {
+    out.spaces(task.indent);
+    out.write("NullLiteral\n");
+}
+
+void ASTPrinter::visitVarExpr(VarExpr* var) {
+    lead(var->line);
+    out.write(var->getIsArgument() ? "(actuals) FieldAccess: \n" : "FieldAccess: \n");
+    printLeaf(var->id, task.indent + 3);
+}
+
+void ASTPrinter::visitBinaryExpr(BinaryExpr* binary) {
+    if (task.step == 0) {
+        lead(binary->line);
+        out.write(BinaryExpr::kindName(binary->op));
+        out.write(": \n");
+        schedule(binary, task.indent, 1);
+        schedule(binary->left, task.indent + 3);
+        return;
+    }
+
+    lead(binary->line);
+    out.write("  Operator: ");
+    out.write(BinaryExpr::operatorText(binary->op));
+    out.put('\n');
+
+    schedule(binary->right, task.indent + 3);
+}
+
+void ASTPrinter::visitUnaryExpr(UnaryExpr* unary) {
+    lead(unary->line);
+    out.write("LogicalExpr: \n");
+    lead(unary->line);
+    out.write(unary->op == UnaryExpr::Minus ? "  Operator: -\n" : "  Operator: !\n");
+    schedule(unary->expr, task.indent + 3);
+}
+
+void ASTPrinter::visitCallExpr(CallExpr* call) {
+    lead(call->line);
+    out.write(call->getIsArgument() ? "(args) Call:\n" : "Call:\n");
+    printLeaf(call->id, task.indent + 3);
+    scheduleAll(call->args, task.indent + 3);
+}
+
+void ASTPrinter::visitAssignExpr(AssignExpr* assign) {
+    if (task.step == 0) {
+        lead(assign->line);
+        out.write("AssignExpr: \n");
+        schedule(assign, task.indent, 1);
+        schedule(assign->left, task.indent + 3);
+        return;
+    }
+
+    lead(assign->line);
+    out.write("   Operator: =\n");
+    schedule(assign->right, task.indent + 3);
+}
+
+void ASTPrinter::visitReadIntegerExpr(ReadIntegerExpr* read) {
+    lead(read->line);
+    out.write("ReadIntegerExpr: \n");
+}
+
+void ASTPrinter::visitReadLineExpr(ReadLineExpr* read) {
+    lead(read->line);
+    out.write("ReadLineExpr: \n");
+}
+
+void ASTPrinter::visitExprStmt(ExprStmt* stmt) {
+    schedule(stmt->expr, task.indent);
+}
+
+void ASTPrinter::visitBlockStmt(BlockStmt* block) {
+    out.spaces(task.indent + 3);
+    out.write("(body) StmtBlock: \n");
+    scheduleAll(block->stmts, task.indent + 3);
+}
+
+void ASTPrinter::visitIfStmt(IfStmt* stmt) {
+    switch (task.step) {
+        case 0:
+            out.spaces(task.indent);
+            out.write("IfStmt: \n");
+            out.spaces(task.indent);
+            out.write("  Condition: \n");
+            schedule(stmt, task.indent, 1);
+            schedule(stmt->cond, task.indent + 4);
+            break;
+        case 1:
+            out.spaces(task.indent);
+            out.write("  Then: \n");
+            if (stmt->elseStmt) {
+                schedule(stmt, task.indent, 2);
+            }
+            schedule(stmt->thenStmt, task.indent + 4);
+            break;
+        default:
+            out.spaces(task.indent);
+            out.write("  Else: \n");
+            schedule(stmt->elseStmt, task.indent + 4);
+            break;
+    }
+}
+
+void ASTPrinter::visitWhileStmt(WhileStmt* stmt) {
+    if (task.step == 0) {
+        out.spaces(task.indent);
+        out.write("WhileStmt: \n");
+        out.spaces(task.indent);
+        out.write("  Condition: \n");
+        schedule(stmt, task.indent, 1);
+        schedule(stmt->cond, task.indent + 4);
+        return;
+    }
+
+    out.spaces(task.indent);
+    out.write("  Body: \n");
+    schedule(stmt->body, task.indent + 4);
+}
+
+// Steps 1 to 3 resume after the init, condition and update expressions,
+// each of which may be absent
+void ASTPrinter::visitForStmt(ForStmt* stmt) {
+    static const char* const labels[] = {"  Init: \n", "  Condition: \n", "  Update: \n"};
+    Expr* parts[] = {stmt->init, stmt->cond, stmt->update};
+
+    if (task.step == 0) {
+        out.spaces(task.indent);
+        out.write("ForStmt: \n");
+    }
+
+    for (int part = task.step; part < 3; part++) {
+        if (parts[part]) {
+            out.spaces(task.indent);
+            out.write(labels[part]);
+            schedule(stmt, task.indent, part + 1);
+            schedule(parts[part], task.indent + 4);
+            return;
+        }
+    }
+
+    out.spaces(task.indent);
+    out.write("  Body: \n");
+    schedule(stmt->body, task.indent + 4);
+}
+
+void ASTPrinter::visitReturnStmt(ReturnStmt* stmt) {
+    lead(stmt->line);
+    out.write("ReturnStmt: \n");
+    if (stmt->expr) {
+        schedule(stmt->expr, task.indent + 3);
+    }
+}
+
+void ASTPrinter::visitBreakStmt(BreakStmt*) {
+    out.spaces(task.indent);
+    out.write("BreakStmt\n");
+}
+
+void ASTPrinter::visitPrintStmt(PrintStmt* stmt) {
+    out.spaces(task.indent + 4);
+    out.write("PrintStmt: \n");
+    scheduleAll(stmt->args, task.indent + 3);
+}
+
+void ASTPrinter::visitVarDeclStmt(VarDeclStmt* stmt) {
+    schedule(stmt->varDecl, task.indent);
+}
+
+void ASTPrinter::visitVarDecl(VarDecl* varDecl) {
+    lead(varDecl->line);
+    out.write("VarDecl: \n");
+    printLeaf(varDecl->type, task.indent + 6);
+    printLeaf(varDecl->id, task.indent + 3);
+    if (varDecl->init) {
+        lead(varDecl->line, -3);
+        out.write("   Init: \n");
+        schedule(varDecl->init, task.indent + 4);
+    }
+}
+
+void ASTPrinter::visitFunctionDecl(FunctionDecl* fnDecl) {
+    lead(fnDecl->line);
+    out.write("FnDecl: \n");
+    out.spaces(task.indent + 6);
+    out.write("(return type) Type: ");
+    out.write(fnDecl->returnType->typeName());
+    out.put('\n');
+    printLeaf(fnDecl->id, task.indent + 3);
+
+    for (VarDecl* formal : fnDecl->formals) {
+        lead(formal->line, 3);
+        out.write("(formals) VarDecl: \n");
+        printLeaf(formal->type, task.indent + 9);
+        printLeaf(formal->id, task.indent + 6);
+    }
+
+    if (fnDecl->body) {
+        schedule(fnDecl->body, task.indent + 3);
+    }
+}
+
+void ASTPrinter::visitProgram(ASTRootNode* root) {
+    out.write("\n   Program: \n");
+    scheduleAll(root->decls, task.indent + 3);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ASTVisitor.h"
+#include "OutputBuffer.h"
+
+// A node to print, with its indent
+struct PrintTask {
+    PrintTask(Node* node = nullptr, int indent = 0, int step = 0)
+        : node(node), indent(indent), step(step) {}
+
+    Node* node;
+    int indent;
+    int step;
+};
+
+// Writes the AST listing of the syntax analyzer tests (samples/syntax_analyzer)
+// into an OutputBuffer. The format, odd indentation included, is the one the
+// node classes used to print themselves.
+//
+// Trees can be as deep as the input is long, so nodes are printed from a
+// work stack (see ASTWorkStack).
+
+class ASTPrinter : public ASTWorkStack<ASTPrinter, PrintTask> {
+public:
+    explicit ASTPrinter(OutputBuffer& out) : out(out) {}
+
+    void print(ASTRootNode* root);
+
+    void visitType(ASTNodeType* type);
+    void visitIdentifier(Identifier* id);
+    void visitIntLiteral(IntLiteral* literal);
+    void visitDoubleLiteral(DoubleLiteral* literal);
+    void visitBoolLiteral(BoolLiteral* literal);
+    void visitStringLiteral(StringLiteral* literal);
+    void visitNullLiteral(NullLiteral* literal);
+    void visitVarExpr(VarExpr* var);
+    void visitBinaryExpr(BinaryExpr* binary);
+    void visitUnaryExpr(UnaryExpr* unary);
+    void visitCallExpr(CallExpr* call);
+    void visitAssignExpr(AssignExpr* assign);
+    void visitReadIntegerExpr(ReadIntegerExpr* read);
+    void visitReadLineExpr(ReadLineExpr* read);
+    void visitExprStmt(ExprStmt* stmt);
+    void visitBlockStmt(BlockStmt* block);
+    void visitIfStmt(IfStmt* stmt);
+    void visitWhileStmt(WhileStmt* stmt);
+    void visitForStmt(ForStmt* stmt);
+    void visitReturnStmt(ReturnStmt* stmt);
+    void visitBreakStmt(BreakStmt* stmt);
+    void visitPrintStmt(PrintStmt* stmt);
+    void visitVarDeclStmt(VarDeclStmt* stmt);
+    void visitVarDecl(VarDecl* varDecl);
+    void visitFunctionDecl(FunctionDecl* fnDecl);
+    void visitProgram(ASTRootNode* root);
+
+private:
+    // Prints an Identifier or Type straight away
+    void printLeaf(Node* node, int nodeIndent);
+
+    // "  <line><indent>", the prefix of most lines
+    void lead(int line, int extra = 0);
+
+    OutputBuffer& out;
+};
@@ -0,0 +1,232 @@
+#pragma once
+
+#include "ASTNodes.h"
+#include <vector>
+
+// Base for passes over the AST, using CRTP. A pass derives from
+// ASTVisitor<Pass, Result> and defines the visitX methods it cares about;
+// they hide the defaults below rather than override them. visit() switches
+// on the node's kind and calls the method through the derived type, so a
+// pass costs no virtual call and no RTTI per node and can be inlined.
+//
+// Methods a pass leaves out fall back by category: visitIntLiteral to
+// visitExpr, visitIfStmt to visitStmt, visitVarDecl to visitDecl, and those
+// in turn to visitNode, which returns Result(). visitChildren() visits the
+// direct children of a node in source order. Both recurse, so a pass that
+// must survive arbitrarily deep trees derives from ASTWorkStack below and
+// calls visit() once per node.
+//
+//   struct CallCounter : ASTVisitor<CallCounter> {
+//       int calls = 0;
+//       void visitCallExpr(CallExpr* call) { calls++; visitChildren(call); }
+//       void visitNode(Node* node) { visitChildren(node); }
+//   };
+template <typename Derived, typename Result = void>
+class ASTVisitor {
+public:
+    Result visit(Node* node) {
+        switch (node->nodeKind) {
+            case NodeKind::Type: return derived().visitType(static_cast<ASTNodeType*>(node));
+            case NodeKind::Identifier: return derived().visitIdentifier(static_cast<Identifier*>(node));
+            case NodeKind::IntLiteral: return derived().visitIntLiteral(static_cast<IntLiteral*>(node));
+            case NodeKind::DoubleLiteral: return derived().visitDoubleLiteral(static_cast<DoubleLiteral*>(node));
+            case NodeKind::BoolLiteral: return derived().visitBoolLiteral(static_cast<BoolLiteral*>(node));
+            case NodeKind::StringLiteral: return derived().visitStringLiteral(static_cast<StringLiteral*>(node));
+            case NodeKind::NullLiteral: return derived().visitNullLiteral(static_cast<NullLiteral*>(node));
+            case NodeKind::VarExpr: return derived().visitVarExpr(static_cast<VarExpr*>(node));
+            case NodeKind::BinaryExpr: return derived().visitBinaryExpr(static_cast<BinaryExpr*>(node));
+            case NodeKind::UnaryExpr: return derived().visitUnaryExpr(static_cast<UnaryExpr*>(node));
+            case NodeKind::CallExpr: return derived().visitCallExpr(static_cast<CallExpr*>(node));
+            case NodeKind::AssignExpr: return derived().visitAssignExpr(static_cast<AssignExpr*>(node));
+            case NodeKind::ReadIntegerExpr: return derived().visitReadIntegerExpr(static_cast<ReadIntegerExpr*>(node));
+            case NodeKind::ReadLineExpr: return derived().visitReadLineExpr(static_cast<ReadLineExpr*>(node));
+            case NodeKind::ExprStmt: return derived().visitExprStmt(static_cast<ExprStmt*>(node));
+            case NodeKind::BlockStmt: return derived().visitBlockStmt(static_cast<BlockStmt*>(node));
+            case NodeKind::IfStmt: return derived().visitIfStmt(static_cast<IfStmt*>(node));
+            case NodeKind::WhileStmt: return derived().visitWhileStmt(static_cast<WhileStmt*>(node));
+            case NodeKind::ForStmt: return derived().visitForStmt(static_cast<ForStmt*>(node));
+            case NodeKind::ReturnStmt: return derived().visitReturnStmt(static_cast<ReturnStmt*>(node));
+            case NodeKind::BreakStmt: return derived().visitBreakStmt(static_cast<BreakStmt*>(node));
+            case NodeKind::PrintStmt: return derived().visitPrintStmt(static_cast<PrintStmt*>(node));
+            case NodeKind::VarDeclStmt: return derived().visitVarDeclStmt(static_cast<VarDeclStmt*>(node));
+            case NodeKind::VarDecl: return derived().visitVarDecl(static_cast<VarDecl*>(node));
+            case NodeKind::FunctionDecl: return derived().visitFunctionDecl(static_cast<FunctionDecl*>(node));
+            case NodeKind::Program: return derived().visitProgram(static_cast<ASTRootNode*>(node));
+        }
+        return Result();
+    }
+
+    // Visits the direct children of node in source order, skipping absent
+    // ones. Types are shared between nodes and are not visited as children.
+    void visitChildren(Node* node) {
+        switch (node->nodeKind) {
+            case NodeKind::VarExpr:
+                visit(static_cast<VarExpr*>(node)->id);
+                break;
+            case NodeKind::BinaryExpr:
+                visit(static_cast<BinaryExpr*>(node)->left);
+                visit(static_cast<BinaryExpr*>(node)->right);
+                break;
+            case NodeKind::UnaryExpr:
+                visit(static_cast<UnaryExpr*>(node)->expr);
+                break;
+            case NodeKind::CallExpr:
+                visit(static_cast<CallExpr*>(node)->id);
+                for (Expr* arg : static_cast<CallExpr*>(node)->args) {
+                    visit(arg);
+                }
+                break;
+            case NodeKind::AssignExpr:
+                visit(static_cast<AssignExpr*>(node)->left);
+                visit(static_cast<AssignExpr*>(node)->right);
+                break;
+            case NodeKind::ExprStmt:
+                visit(static_cast<ExprStmt*>(node)->expr);
+                break;
+            case NodeKind::BlockStmt:
+                for (Stmt* stmt : static_cast<BlockStmt*>(node)->stmts) {
+                    visit(stmt);
+                }
+                break;
+            case NodeKind::IfStmt:
+                visitIfPresent(static_cast<IfStmt*>(node)->cond);
+                visitIfPresent(static_cast<IfStmt*>(node)->thenStmt);
+                visitIfPresent(static_cast<IfStmt*>(node)->elseStmt);
+                break;
+            case NodeKind::WhileStmt:
+                visitIfPresent(static_cast<WhileStmt*>(node)->cond);
+                visitIfPresent(static_cast<WhileStmt*>(node)->body);
+                break;
+            case NodeKind::ForStmt:
+                visitIfPresent(static_cast<ForStmt*>(node)->init);
+                visitIfPresent(static_cast<ForStmt*>(node)->cond);
+                visitIfPresent(static_cast<ForStmt*>(node)->update);
+                visitIfPresent(static_cast<ForStmt*>(node)->body);
+                break;
+            case NodeKind::ReturnStmt:
+                visitIfPresent(static_cast<ReturnStmt*>(node)->expr);
+                break;
+            case NodeKind::PrintStmt:
+                for (Expr* arg : static_cast<PrintStmt*>(node)->args) {
+                    visit(arg);
+                }
+                break;
+            case NodeKind::VarDeclStmt:
+                visit(static_cast<VarDeclStmt*>(node)->varDecl);
+                break;
+            case NodeKind::VarDecl:
+                visit(static_cast<VarDecl*>(node)->id);
+                visitIfPresent(static_cast<VarDecl*>(node)->init);
+                break;
+            case NodeKind::FunctionDecl:
+                visit(static_cast<FunctionDecl*>(node)->id);
+                for (VarDecl* formal : static_cast<FunctionDecl*>(node)->formals) {
+                    visit(formal);
+                }
+                visitIfPresent(static_cast<FunctionDecl*>(node)->body);
+                break;
+            case NodeKind::Program:
+                for (Decl* decl : static_cast<ASTRootNode*>(node)->decls) {
+                    visit(decl);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Defaults, by category
+    Result visitType(ASTNodeType* node) { return derived().visitNode(node); }
+    Result visitIdentifier(Identifier* node) { return derived().visitNode(node); }
+    Result visitIntLiteral(IntLiteral* node) { return derived().visitExpr(node); }
+    Result visitDoubleLiteral(DoubleLiteral* node) { return derived().visitExpr(node); }
+    Result visitBoolLiteral(BoolLiteral* node) { return derived().visitExpr(node); }
+    Result visitStringLiteral(StringLiteral* node) { return derived().visitExpr(node); }
+    Result visitNullLiteral(NullLiteral* node) { return derived().visitExpr(node); }
+    Result visitVarExpr(VarExpr* node) { return derived().visitExpr(node); }
+    Result visitBinaryExpr(BinaryExpr* node) { return derived().visitExpr(node); }
+    Result visitUnaryExpr(UnaryExpr* node) { return derived().visitExpr(node); }
+    Result visitCallExpr(CallExpr* node) { return derived().visitExpr(node); }
+    Result visitAssignExpr(AssignExpr* node) { return derived().visitExpr(node); }
+    Result visitReadIntegerExpr(ReadIntegerExpr* node) { return derived().visitExpr(node); }
+    Result visitReadLineExpr(ReadLineExpr* node) { return derived().visitExpr(node); }
+    Result visitExprStmt(ExprStmt* node) { return derived().visitStmt(node); }
+    Result visitBlockStmt(BlockStmt* node) { return derived().visitStmt(node); }
+    Result visitIfStmt(IfStmt* node) { return derived().visitStmt(node); }
+    Result visitWhileStmt(WhileStmt* node) { return derived().visitStmt(node); }
+    Result visitForStmt(ForStmt* node) { return derived().visitStmt(node); }
+    Result visitReturnStmt(ReturnStmt* node) { return derived().visitStmt(node); }
+    Result visitBreakStmt(BreakStmt* node) { return derived().visitStmt(node); }
+    Result visitPrintStmt(PrintStmt* node) { return derived().visitStmt(node); }
+    Result visitVarDeclStmt(VarDeclStmt* node) { return derived().visitStmt(node); }
+    Result visitVarDecl(VarDecl* node) { return derived().visitDecl(node); }
+    Result visitFunctionDecl(FunctionDecl* node) { return derived().visitDecl(node); }
+    Result visitProgram(ASTRootNode* node) { return derived().visitNode(node); }
+
+    Result visitExpr(Expr* node) { return derived().visitNode(node); }
+    Result visitStmt(Stmt* node) { return derived().visitNode(node); }
+    Result visitDecl(Decl* node) { return derived().visitNode(node); }
+    Result visitNode(Node*) { return Result(); }
+
+protected:
+    Derived& derived() { return static_cast<Derived&>(*this); }
+
+private:
+    void visitIfPresent(Node* node) {
+        if (node) {
+            visit(node);
+        }
+    }
+};
+
+// A node to visit and the step of its visit to run, 0 the first time
+struct ASTTask {
+    ASTTask(Node* node = nullptr, int step = 0) : node(node), step(step) {}
+
+    Node* node;
+    int step;
+};
+
+// Base for passes that visit the tree from an explicit work stack, so any
+// depth of nesting costs no native stack. A visit method does what comes
+// before its first child and schedules the children; a node with more to
+// do between or after them also schedules itself again with the next step.
+// run() visits tasks until there are none left, the one being visited in
+// `task`.
+//
+// Task has a node and a step, like ASTTask. A pass that needs more per
+// node, such as ASTPrinter's indent or the labels of a statement in
+// TACGenerator, uses a task of its own; schedule() passes its arguments to
+// the task's constructor, which must default all but the node.
+template <typename Derived, typename Task = ASTTask>
+class ASTWorkStack : public ASTVisitor<Derived> {
+protected:
+    ASTWorkStack() : task() {}
+
+    // Tasks run last in, first out: schedule children in reverse order.
+    // Absent children, such as the body a syntax error left out, are skipped.
+    template <typename... Fields>
+    void schedule(Node* node, Fields... fields) {
+        if (node) {
+            work.push_back(Task{node, fields...});
+        }
+    }
+
+    template <typename T, typename... Fields>
+    void scheduleAll(const ArenaList<T>& nodes, Fields... fields) {
+        for (size_t i = nodes.size(); i > 0; i--) {
+            schedule(nodes[i - 1], fields...);
+        }
+    }
+
+    void run() {
+        while (!work.empty()) {
+            task = work.back();
+            work.pop_back();
+            this->visit(task.node);
+        }
+    }
+
+    std::vector<Task> work;
+    Task task; // Being visited
+};
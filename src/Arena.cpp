@@ -0,0 +1,30 @@
+#include "Arena.h"
+#include <cstdlib>
+
+Arena::Arena() : cursor(nullptr), limit(nullptr), retired(0) {}
+
+Arena::~Arena() {
+    for (char* block : blocks) {
+        std::free(block);
+    }
+}
+
+void Arena::newBlock(size_t minimum) {
+    if (!blocks.empty()) {
+        retired += cursor - blocks.back();
+    }
+
+    // Oversized requests get a block of their own
+    size_t size = minimum > BlockSize ? minimum : BlockSize;
+    char* block = static_cast<char*>(std::malloc(size));
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    blocks.push_back(block);
+    cursor = block;
+    limit = block + size;
+}
+
+size_t Arena::bytesUsed() const {
+    return blocks.empty() ? 0 : retired + (cursor - blocks.back());
+}
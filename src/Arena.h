@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator that owns everything built for one compilation. Objects
+// are carved out of large blocks and never freed one by one: the blocks
+// go all at once when the Arena is destroyed. Destructors are never run,
+// so only trivially destructible types may live in it.
+class Arena {
+public:
+    Arena();
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align) {
+        size_t offset = (align - ((size_t)cursor & (align - 1))) & (align - 1);
+        if (size + offset > (size_t)(limit - cursor)) {
+            newBlock(size + align);
+            offset = (align - ((size_t)cursor & (align - 1))) & (align - 1);
+        }
+        char* result = cursor + offset;
+        cursor = result + size;
+        return result;
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "Arena never runs destructors");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    T* makeArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "Arena never runs destructors");
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    // Bytes handed out so far, including alignment padding
+    size_t bytesUsed() const;
+
+    static const size_t BlockSize = 64 * 1024;
+
+private:
+    void newBlock(size_t minimum);
+
+    char* cursor;
+    char* limit;
+    std::vector<char*> blocks;
+    size_t retired; // Bytes used in blocks before the current one
+};
+
+// Growable array whose storage comes from an Arena, for the child lists of
+// AST nodes. Growing doubles the capacity and leaves the old storage behind
+// in the arena. Only holds trivially copyable values such as node pointers.
+template <typename T>
+class ArenaList {
+public:
+    explicit ArenaList(Arena& arena) : arena(&arena), items(nullptr), count(0), capacity(0) {}
+
+    void push_back(const T& value) {
+        if (count == capacity) {
+            grow();
+        }
+        items[count++] = value;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T& operator[](size_t index) const { return items[index]; }
+    T* begin() const { return items; }
+    T* end() const { return items + count; }
+
+private:
+    void grow() {
+        static_assert(std::is_trivially_copyable<T>::value, "ArenaList copies with memcpy");
+        size_t larger = capacity == 0 ? 4 : capacity * 2;
+        T* storage = arena->makeArray<T>(larger);
+        if (count > 0) {
+            std::memcpy(storage, items, sizeof(T) * count);
+        }
+        items = storage;
+        capacity = larger;
+    }
+
+    Arena* arena;
+    T* items;
+    size_t count;
+    size_t capacity;
+};
@@ -0,0 +1,613 @@
+#include "FlatAST.h"
+#include "MappedAST.h"
+#include "ASTVisitor.h"
+#include <cstring>
+
+const NodeId FlatAST::NoNode;
+const unsigned char FlatAST::Argument;
+
+FlatAST::FlatAST(const Interner& names) : names(names), root(NoNode) {}
+
+NodeId FlatAST::add(FlatKind kind, int line, int column) {
+    NodeId node = kinds.size();
+    kinds.push_back(kind);
+    ops.push_back(0);
+    flags.push_back(0);
+    lines.push_back(line);
+    columns.push_back(column);
+    first.push_back(NoNode);
+    second.push_back(NoNode);
+    return node;
+}
+
+size_t FlatAST::reserveList(NodeId node, size_t count) {
+    size_t start = lists.size();
+    first[node] = start;
+    second[node] = count;
+    lists.resize(start + count, NoNode);
+    return start;
+}
+
+double FlatAST::doubleValue(NodeId node) const {
+    uint64_t bits = (uint64_t)second[node] << 32 | first[node];
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void FlatAST::setDoubleValue(NodeId node, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    first[node] = (uint32_t)bits;
+    second[node] = (uint32_t)(bits >> 32);
+}
+
+size_t FlatAST::bytes() const {
+    return size() * (sizeof(FlatKind) + 2 + 2 * sizeof(int32_t) + 2 * sizeof(uint32_t)) +
+        lists.size() * sizeof(NodeId) + strings.size() * sizeof(TextRef);
+}
+
+// A node to flatten and the slot that receives its ID: an entry of
+// flat.first, flat.second or flat.lists. The root has no slot.
+struct SlotTask {
+    SlotTask(Node* node = nullptr, std::vector<uint32_t>* slots = nullptr, size_t index = 0)
+        : node(node), slots(slots), index(index) {}
+
+    Node* node;
+    std::vector<uint32_t>* slots;
+    size_t index;
+};
+
+// Walks the class tree on a work stack (see ASTWorkStack) and appends
+// every node in preorder. A visit method adds its node, which stores the
+// new ID in the task's slot, then schedules its children, each with the
+// slot for its own ID: a field of the node or an entry of its list, which
+// is reserved up front. Children are scheduled in reverse, so that they
+// come off the stack, and get their IDs, in source order.
+class Flattener : public ASTWorkStack<Flattener, SlotTask> {
+public:
+    explicit Flattener(FlatAST& flat) : flat(flat) {}
+
+    NodeId flatten(ASTRootNode* root);
+
+    void visitIdentifier(Identifier* id);
+    void visitIntLiteral(IntLiteral* literal);
+    void visitDoubleLiteral(DoubleLiteral* literal);
+    void visitBoolLiteral(BoolLiteral* literal);
+    void visitStringLiteral(StringLiteral* literal);
+    void visitNullLiteral(NullLiteral* literal);
+    void visitVarExpr(VarExpr* var);
+    void visitBinaryExpr(BinaryExpr* binary);
+    void visitUnaryExpr(UnaryExpr* unary);
+    void visitCallExpr(CallExpr* call);
+    void visitAssignExpr(AssignExpr* assign);
+    void visitReadIntegerExpr(ReadIntegerExpr* read);
+    void visitReadLineExpr(ReadLineExpr* read);
+    void visitExprStmt(ExprStmt* stmt);
+    void visitBlockStmt(BlockStmt* block);
+    void visitIfStmt(IfStmt* stmt);
+    void visitWhileStmt(WhileStmt* stmt);
+    void visitForStmt(ForStmt* stmt);
+    void visitReturnStmt(ReturnStmt* stmt);
+    void visitBreakStmt(BreakStmt* stmt);
+    void visitPrintStmt(PrintStmt* stmt);
+    void visitVarDeclStmt(VarDeclStmt* stmt);
+    void visitVarDecl(VarDecl* varDecl);
+    void visitFunctionDecl(FunctionDecl* fnDecl);
+    void visitProgram(ASTRootNode* root);
+
+private:
+    // Each node of the list gets the entry of flat.lists from start on
+    template <typename T>
+    void scheduleList(const ArenaList<T>& nodes, size_t start) {
+        for (size_t i = nodes.size(); i > 0; i--) {
+            schedule(nodes[i - 1], &flat.lists, start + i - 1);
+        }
+    }
+
+    NodeId add(FlatKind kind, const Node* node);
+    NodeId addExpr(FlatKind kind, const Expr* expr);
+
+    FlatAST& flat;
+};
+
+// The root comes first in preorder
+NodeId Flattener::flatten(ASTRootNode* root) {
+    NodeId node = flat.size();
+    schedule(root);
+    run();
+    return node;
+}
+
+NodeId Flattener::add(FlatKind kind, const Node* node) {
+    NodeId id = flat.add(kind, node->line, node->column);
+    if (task.slots) {
+        (*task.slots)[task.index] = id;
+    }
+    return id;
+}
+
+NodeId Flattener::addExpr(FlatKind kind, const Expr* expr) {
+    NodeId node = add(kind, expr);
+    if (expr->getIsArgument()) {
+        flat.flags[node] |= FlatAST::Argument;
+    }
+    return node;
+}
+
+void Flattener::visitProgram(ASTRootNode* root) {
+    NodeId node = add(FlatKind::Program, root);
+    size_t start = flat.reserveList(node, root->decls.size());
+    scheduleList(root->decls, start);
+}
+
+void Flattener::visitIdentifier(Identifier* id) {
+    NodeId node = add(FlatKind::Identifier, id);
+    flat.first[node] = id->symbol;
+}
+
+void Flattener::visitVarDecl(VarDecl* varDecl) {
+    NodeId node = add(FlatKind::VarDecl, varDecl);
+    flat.ops[node] = varDecl->type->kind;
+    schedule(varDecl->init, &flat.second, node);
+    schedule(varDecl->id, &flat.first, node);
+}
+
+void Flattener::visitFunctionDecl(FunctionDecl* fnDecl) {
+    NodeId node = add(FlatKind::FnDecl, fnDecl);
+    flat.ops[node] = fnDecl->returnType->kind;
+
+    // Identifier, body, formals; the body comes last in preorder
+    size_t start = flat.reserveList(node, 2 + fnDecl->formals.size());
+    schedule(fnDecl->body, &flat.lists, start + 1);
+    scheduleList(fnDecl->formals, start + 2);
+    schedule(fnDecl->id, &flat.lists, start);
+}
+
+void Flattener::visitBlockStmt(BlockStmt* block) {
+    NodeId node = add(FlatKind::Block, block);
+    size_t start = flat.reserveList(node, block->stmts.size());
+    scheduleList(block->stmts, start);
+}
+
+void Flattener::visitIfStmt(IfStmt* stmt) {
+    NodeId node = add(FlatKind::If, stmt);
+    size_t start = flat.reserveList(node, 3);
+    schedule(stmt->elseStmt, &flat.lists, start + 2);
+    schedule(stmt->thenStmt, &flat.lists, start + 1);
+    schedule(stmt->cond, &flat.lists, start);
+}
+
+void Flattener::visitWhileStmt(WhileStmt* stmt) {
+    NodeId node = add(FlatKind::While, stmt);
+    schedule(stmt->body, &flat.second, node);
+    schedule(stmt->cond, &flat.first, node);
+}
+
+void Flattener::visitForStmt(ForStmt* stmt) {
+    NodeId node = add(FlatKind::For, stmt);
+    size_t start = flat.reserveList(node, 4);
+    schedule(stmt->body, &flat.lists, start + 3);
+    schedule(stmt->update, &flat.lists, start + 2);
+    schedule(stmt->cond, &flat.lists, start + 1);
+    schedule(stmt->init, &flat.lists, start);
+}
+
+void Flattener::visitReturnStmt(ReturnStmt* stmt) {
+    NodeId node = add(FlatKind::Return, stmt);
+    schedule(stmt->expr, &flat.first, node);
+}
+
+void Flattener::visitBreakStmt(BreakStmt* stmt) {
+    add(FlatKind::Break, stmt);
+}
+
+void Flattener::visitPrintStmt(PrintStmt* stmt) {
+    NodeId node = add(FlatKind::Print, stmt);
+    size_t start = flat.reserveList(node, stmt->args.size());
+    scheduleList(stmt->args, start);
+}
+
+void Flattener::visitExprStmt(ExprStmt* stmt) {
+    NodeId node = add(FlatKind::ExprStmt, stmt);
+    schedule(stmt->expr, &flat.first, node);
+}
+
+void Flattener::visitVarDeclStmt(VarDeclStmt* stmt) {
+    NodeId node = add(FlatKind::VarDeclStmt, stmt);
+    schedule(stmt->varDecl, &flat.first, node);
+}
+
+void Flattener::visitIntLiteral(IntLiteral* literal) {
+    NodeId node = addExpr(FlatKind::IntConstant, literal);
+    flat.first[node] = (uint32_t)literal->value;
+}
+
+void Flattener::visitDoubleLiteral(DoubleLiteral* literal) {
+    NodeId node = addExpr(FlatKind::DoubleConstant, literal);
+    flat.setDoubleValue(node, literal->value);
+}
+
+void Flattener::visitBoolLiteral(BoolLiteral* literal) {
+    NodeId node = addExpr(FlatKind::BoolConstant, literal);
+    flat.first[node] = literal->value;
+}
+
+void Flattener::visitStringLiteral(StringLiteral* literal) {
+    NodeId node = addExpr(FlatKind::StringConstant, literal);
+    flat.first[node] = flat.strings.size();
+    flat.strings.push_back(literal->value);
+}
+
+void Flattener::visitNullLiteral(NullLiteral* literal) {
+    addExpr(FlatKind::Null, literal);
+}
+
+void Flattener::visitVarExpr(VarExpr* var) {
+    NodeId node = addExpr(FlatKind::Var, var);
+    flat.ops[node] = var->varType->kind;
+    schedule(var->id, &flat.first, node);
+}
+
+void Flattener::visitBinaryExpr(BinaryExpr* binary) {
+    NodeId node = addExpr(FlatKind::Binary, binary);
+    flat.ops[node] = binary->op;
+    schedule(binary->right, &flat.second, node);
+    schedule(binary->left, &flat.first, node);
+}
+
+void Flattener::visitUnaryExpr(UnaryExpr* unary) {
+    NodeId node = addExpr(FlatKind::Unary, unary);
+    flat.ops[node] = unary->op;
+    schedule(unary->expr, &flat.first, node);
+}
+
+void Flattener::visitCallExpr(CallExpr* call) {
+    NodeId node = addExpr(FlatKind::Call, call);
+    size_t start = flat.reserveList(node, 1 + call->args.size());
+    scheduleList(call->args, start + 1);
+    schedule(call->id, &flat.lists, start);
+}
+
+void Flattener::visitAssignExpr(AssignExpr* assign) {
+    NodeId node = addExpr(FlatKind::Assign, assign);
+    schedule(assign->right, &flat.second, node);
+    schedule(assign->left, &flat.first, node);
+}
+
+void Flattener::visitReadIntegerExpr(ReadIntegerExpr* read) {
+    addExpr(FlatKind::ReadInteger, read);
+}
+
+void Flattener::visitReadLineExpr(ReadLineExpr* read) {
+    addExpr(FlatKind::ReadLine, read);
+}
+
+void flatten_ast(ASTRootNode* root, FlatAST& flat) {
+    flat.root = Flattener(flat).flatten(root);
+}
+
+// Mirrors ASTPrinter, quirks included, work stack and steps too. Tree is
+// FlatAST or MappedAST, which have the same arrays and accessors.
+template <typename Tree>
+class FlatPrinter {
+public:
+    FlatPrinter(const Tree& flat, OutputBuffer& out) : flat(flat), out(out) {}
+
+    void print(NodeId root);
+
+private:
+    struct Task {
+        NodeId node;
+        int indent;
+        int step;
+    };
+
+    void schedule(NodeId node, int indent, int step = 0) {
+        if (node != FlatAST::NoNode) {
+            work.push_back(Task{node, indent, step});
+        }
+    }
+
+    void scheduleList(const NodeId* begin, const NodeId* end, int indent) {
+        while (end != begin) {
+            schedule(*--end, indent);
+        }
+    }
+
+    void print(NodeId node, int indent, int step);
+    void lead(NodeId node, int indent);
+    void spaces(int count) { out.spaces(count); }
+    void type(unsigned char kind, int indent);
+    void identifier(NodeId node, int indent);
+
+    const Tree& flat;
+    OutputBuffer& out;
+    std::vector<Task> work;
+};
+
+template <typename Tree>
+void FlatPrinter<Tree>::print(NodeId root) {
+    schedule(root, 0);
+    while (!work.empty()) {
+        Task task = work.back();
+        work.pop_back();
+        print(task.node, task.indent, task.step);
+    }
+}
+
+// "  <line><indent>", the prefix of most lines
+template <typename Tree>
+void FlatPrinter<Tree>::lead(NodeId node, int indent) {
+    out.write("  ");
+    out.writeInt(flat.lines[node]);
+    spaces(indent);
+}
+
+template <typename Tree>
+void FlatPrinter<Tree>::type(unsigned char kind, int indent) {
+    spaces(indent);
+    out.write("Type: ");
+    out.write(ASTNodeType::kindName((ASTNodeType::TypeKind)kind));
+    out.put('\n');
+}
+
+template <typename Tree>
+void FlatPrinter<Tree>::identifier(NodeId node, int indent) {
+    lead(node, indent);
+    out.write("Identifier: ");
+    out.write(flat.name(flat.first[node]));
+    out.put('\n');
+}
+
+template <typename Tree>
+void FlatPrinter<Tree>::print(NodeId node, int indent, int step) {
+    bool argument = flat.flags[node] & FlatAST::Argument;
+    uint32_t first = flat.first[node];
+    uint32_t second = flat.second[node];
+
+    switch (flat.kinds[node]) {
+        case FlatKind::Program:
+            out.write("\n   Program: \n");
+            scheduleList(flat.listBegin(node), flat.listEnd(node), indent + 3);
+            break;
+
+        case FlatKind::FnDecl: {
+            const NodeId* children = flat.listBegin(node);
+            lead(node, indent);
+            out.write("FnDecl: \n");
+            spaces(indent + 6);
+            out.write("(return type) Type: ");
+            out.write(ASTNodeType::kindName((ASTNodeType::TypeKind)flat.ops[node]));
+            out.put('\n');
+            identifier(children[0], indent + 3);
+            for (const NodeId* formal = children + 2; formal != flat.listEnd(node); formal++) {
+                lead(*formal, indent + 3);
+                out.write("(formals) VarDecl: \n");
+                type(flat.ops[*formal], indent + 9);
+                identifier(flat.first[*formal], indent + 6);
+            }
+            schedule(children[1], indent + 3);
+            break;
+        }
+
+        case FlatKind::VarDecl:
+            lead(node, indent);
+            out.write("VarDecl: \n");
+            type(flat.ops[node], indent + 6);
+            identifier(first, indent + 3);
+            if (second != FlatAST::NoNode) {
+                lead(node, indent - 3);
+                out.write("   Init: \n");
+                schedule(second, indent + 4);
+            }
+            break;
+
+        case FlatKind::VarDeclStmt:
+        case FlatKind::ExprStmt:
+            schedule(first, indent);
+            break;
+
+        case FlatKind::Block:
+            spaces(indent + 3);
+            out.write("(body) StmtBlock: \n");
+            scheduleList(flat.listBegin(node), flat.listEnd(node), indent + 3);
+            break;
+
+        case FlatKind::If: {
+            const NodeId* children = flat.listBegin(node);
+            if (step == 0) {
+                spaces(indent);
+                out.write("IfStmt: \n");
+                spaces(indent);
+                out.write("  Condition: \n");
+                schedule(node, indent, 1);
+                schedule(children[0], indent + 4);
+            } else if (step == 1) {
+                spaces(indent);
+                out.write("  Then: \n");
+                if (children[2] != FlatAST::NoNode) {
+                    schedule(node, indent, 2);
+                }
+                schedule(children[1], indent + 4);
+            } else {
+                spaces(indent);
+                out.write("  Else: \n");
+                schedule(children[2], indent + 4);
+            }
+            break;
+        }
+
+        case FlatKind::While:
+            if (step == 0) {
+                spaces(indent);
+                out.write("WhileStmt: \n");
+                spaces(indent);
+                out.write("  Condition: \n");
+                schedule(node, indent, 1);
+                schedule(first, indent + 4);
+                break;
+            }
+            spaces(indent);
+            out.write("  Body: \n");
+            schedule(second, indent + 4);
+            break;
+
+        case FlatKind::For: {
+            static const char* const labels[] = {"  Init: \n", "  Condition: \n", "  Update: \n"};
+            const NodeId* children = flat.listBegin(node);
+            if (step == 0) {
+                spaces(indent);
+                out.write("ForStmt: \n");
+            }
+            // Step k resumes after the k-th part of the header
+            int part = step;
+            while (part < 3 && children[part] == FlatAST::NoNode) {
+                part++;
+            }
+            if (part < 3) {
+                spaces(indent);
+                out.write(labels[part]);
+                schedule(node, indent, part + 1);
+                schedule(children[part], indent + 4);
+                break;
+            }
+            spaces(indent);
+            out.write("  Body: \n");
+            schedule(children[3], indent + 4);
+            break;
+        }
+
+        case FlatKind::Return:
+            lead(node, indent);
+            out.write("ReturnStmt: \n");
+            schedule(first, indent + 3);
+            break;
+
+        case FlatKind::Break:
+            spaces(indent);
+            out.write("BreakStmt\n");
+            break;
+
+        case FlatKind::Print:
+            spaces(indent + 4);
+            out.write("PrintStmt: \n");
+            scheduleList(flat.listBegin(node), flat.listEnd(node), indent + 3);
+            break;
+
+        case FlatKind::Identifier:
+            identifier(node, indent);
+            break;
+
+        case FlatKind::IntConstant:
+            lead(node, indent);
+            out.write("IntConstant: ");
+            out.writeInt((int32_t)first);
+            out.put('\n');
+            break;
+
+        case FlatKind::DoubleConstant: {
+            // Default ostream formatting, which is %g
+            char digits[32];
+            int length = std::snprintf(digits, sizeof(digits), "%g", flat.doubleValue(node));
+            lead(node, indent);
+            out.write("DoubleConstant: ");
+            out.write(digits, length);
+            out.put('\n');
+            break;
+        }
+
+        case FlatKind::BoolConstant:
+            lead(node, indent);
+            out.write(first ? "BoolConstant: true\n" : "BoolConstant: false\n");
+            break;
+
+        case FlatKind::StringConstant:
+            if (argument) {
+                out.write("  ");
+                out.writeInt(flat.lines[node]);
+                out.write("         (args) StringConstant: ");
+            } else {
+                spaces(indent);
+                out.write("StringConstant: ");
+            }
+            out.write(flat.string(first));
+            out.put('\n');
+            break;
+
+        case FlatKind::Null:
+            spaces(indent);
+            out.write("NullLiteral\n");
+            break;
+
+        case FlatKind::Var:
+            lead(node, indent);
+            out.write(argument ? "(actuals) FieldAccess: \n" : "FieldAccess: \n");
+            identifier(first, indent + 3);
+            break;
+
+        case FlatKind::Binary:
+            if (step == 0) {
+                lead(node, indent);
+                out.write(BinaryExpr::kindName((BinaryExpr::BinaryOp)flat.ops[node]));
+                out.write(": \n");
+                schedule(node, indent, 1);
+                schedule(first, indent + 3);
+                break;
+            }
+            lead(node, indent);
+            out.write("  Operator: ");
+            out.write(BinaryExpr::operatorText((BinaryExpr::BinaryOp)flat.ops[node]));
+            out.put('\n');
+            schedule(second, indent + 3);
+            break;
+
+        case FlatKind::Unary:
+            lead(node, indent);
+            out.write("LogicalExpr: \n");
+            lead(node, indent);
+            out.write(flat.ops[node] == UnaryExpr::Minus ? "  Operator: -\n" : "  Operator: !\n");
+            schedule(first, indent + 3);
+            break;
+
+        case FlatKind::Call: {
+            const NodeId* children = flat.listBegin(node);
+            lead(node, indent);
+            out.write(argument ? "(args) Call:\n" : "Call:\n");
+            identifier(children[0], indent + 3);
+            scheduleList(children + 1, flat.listEnd(node), indent + 3);
+            break;
+        }
+
+        case FlatKind::Assign:
+            if (step == 0) {
+                lead(node, indent);
+                out.write("AssignExpr: \n");
+                schedule(node, indent, 1);
+                schedule(first, indent + 3);
+                break;
+            }
+            lead(node, indent);
+            out.write("   Operator: =\n");
+            schedule(second, indent + 3);
+            break;
+
+        case FlatKind::ReadInteger:
+            lead(node, indent);
+            out.write("ReadIntegerExpr: \n");
+            break;
+
+        case FlatKind::ReadLine:
+            lead(node, indent);
+            out.write("ReadLineExpr: \n");
+            break;
+    }
+}
+
+void print_flat_ast(const FlatAST& flat, OutputBuffer& out) {
+    FlatPrinter<FlatAST>(flat, out).print(flat.root);
+}
+
+void print_flat_ast(const MappedAST& flat, OutputBuffer& out) {
+    FlatPrinter<MappedAST>(flat, out).print(flat.root);
+}
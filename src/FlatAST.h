@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include "Token.h"
+#include "Interner.h"
+#include "OutputBuffer.h"
+
+class ASTRootNode;
+class MappedAST;
+
+typedef uint32_t NodeId;
+
+enum class FlatKind : unsigned char {
+    Program,      // list: decls
+    FnDecl,       // op: return type, list: identifier, body or NoNode, formals...
+    VarDecl,      // op: type, first: identifier, second: init or NoNode
+    VarDeclStmt,  // first: VarDecl
+    Block,        // list: statements
+    If,           // list: condition, then, else or NoNode
+    While,        // first: condition, second: body
+    For,          // list: init, condition, update (each may be NoNode), body
+    Return,       // first: value or NoNode
+    Break,
+    Print,        // list: arguments
+    ExprStmt,     // first: expression
+    Identifier,   // first: symbol ID
+    IntConstant,  // first: value
+    DoubleConstant, // first and second: low and high half of the value's bits
+    BoolConstant, // first: 0 or 1
+    StringConstant, // first: index into strings
+    Null,
+    Var,          // op: type the parser resolved, first: identifier
+    Binary,       // op: BinaryExpr::BinaryOp, first: left, second: right
+    Unary,        // op: UnaryExpr::UnaryOp, first: operand
+    Call,         // list: identifier, arguments...
+    Assign,       // first: target, second: value
+    ReadInteger,
+    ReadLine
+};
+
+// The AST as parallel arrays indexed by 32-bit node IDs, an alternative to
+// the pointer linked classes in ASTNodes.h. Every node has a kind, an
+// operator or type byte, flags, a source position and two operand words,
+// 19 bytes in all. Children are referred to by ID, nodes with a variable
+// number of children keep them as a range of the shared lists array.
+// Nodes are numbered in preorder, so a parent's ID is below its children's.
+class FlatAST {
+public:
+    explicit FlatAST(const Interner& names);
+
+    static const NodeId NoNode = 0xFFFFFFFFu;
+    static const unsigned char Argument = 1; // Flag: expression is a call or Print argument
+
+    NodeId add(FlatKind kind, int line, int column);
+
+    // Makes node a list node of count children, all NoNode for now, and
+    // returns the index of the first in lists
+    size_t reserveList(NodeId node, size_t count);
+
+    size_t size() const { return kinds.size(); }
+
+    // Children of a list node
+    const NodeId* listBegin(NodeId node) const { return lists.data() + first[node]; }
+    const NodeId* listEnd(NodeId node) const { return lists.data() + first[node] + second[node]; }
+
+    double doubleValue(NodeId node) const;
+    void setDoubleValue(NodeId node, double value);
+
+    // Text of a StringConstant, by the index in its first word
+    TextRef string(uint32_t index) const { return strings[index]; }
+    // Name of an Identifier, by the symbol ID in its first word
+    TextRef name(uint32_t symbol) const { return names.name(symbol); }
+
+    // Bytes held by the arrays, not counting unused capacity
+    size_t bytes() const;
+
+    std::vector<FlatKind> kinds;
+    std::vector<unsigned char> ops;
+    std::vector<unsigned char> flags;
+    std::vector<int32_t> lines;
+    std::vector<int32_t> columns;
+    std::vector<uint32_t> first;
+    std::vector<uint32_t> second;
+
+    std::vector<NodeId> lists;
+    std::vector<TextRef> strings;
+    const Interner& names;
+    NodeId root;
+};
+
+// Flat copy of a tree built by the ASTBuilder
+void flatten_ast(ASTRootNode* root, FlatAST& flat);
+
+// Same output as ASTPrinter
+void print_flat_ast(const FlatAST& flat, OutputBuffer& out);
+void print_flat_ast(const MappedAST& flat, OutputBuffer& out);
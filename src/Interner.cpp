@@ -0,0 +1,52 @@
+#include "Interner.h"
+#include <cstring>
+
+const uint32_t Interner::NoSymbol;
+
+Interner::Interner() : slots(64, NoSymbol), mask(63) {}
+
+// FNV-1a, identifiers are short
+uint32_t Interner::hash(const char* text, size_t length) {
+    uint32_t h = 2166136261u;
+    for (size_t k = 0; k < length; k++) {
+        h = (h ^ (unsigned char)text[k]) * 16777619u;
+    }
+    return h;
+}
+
+uint32_t Interner::intern(const char* text, size_t length) {
+    uint32_t h = hash(text, length);
+    size_t slot = h & mask;
+    while (slots[slot] != NoSymbol) {
+        uint32_t symbol = slots[slot];
+        const TextRef& known = names[symbol];
+        if (hashes[symbol] == h && known.size() == length &&
+            std::memcmp(known.data(), text, length) == 0) {
+            return symbol;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    uint32_t symbol = names.size();
+    names.push_back(TextRef(text, length));
+    hashes.push_back(h);
+    slots[slot] = symbol;
+
+    // Keep the load factor at or below one half
+    if (names.size() * 2 > slots.size()) {
+        grow();
+    }
+    return symbol;
+}
+
+void Interner::grow() {
+    slots.assign(slots.size() * 2, NoSymbol);
+    mask = slots.size() - 1;
+    for (uint32_t symbol = 0; symbol < names.size(); symbol++) {
+        size_t slot = hashes[symbol] & mask;
+        while (slots[slot] != NoSymbol) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = symbol;
+    }
+}
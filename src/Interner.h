@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include "Token.h"
+
+// Maps every distinct identifier to a dense 32-bit symbol ID, handed out in
+// order of first appearance starting at 0. Names are not copied: each one
+// refers to its first occurrence in the source buffer, which has to outlive
+// the table.
+class Interner {
+public:
+    Interner();
+
+    // ID of the name, adding it if it has not been seen before
+    uint32_t intern(const char* text, size_t length);
+    uint32_t intern(const TextRef& text) { return intern(text.data(), text.size()); }
+
+    TextRef name(uint32_t symbol) const { return names[symbol]; }
+    size_t size() const { return names.size(); }
+
+    static const uint32_t NoSymbol = 0xFFFFFFFFu;
+
+private:
+    static uint32_t hash(const char* text, size_t length);
+    void grow();
+
+    std::vector<TextRef> names;    // Indexed by symbol ID
+    std::vector<uint32_t> hashes;  // Indexed by symbol ID
+    std::vector<uint32_t> slots;   // Open addressing, symbol ID or NoSymbol
+    size_t mask;
+};
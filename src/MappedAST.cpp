@@ -0,0 +1,187 @@
+#include "MappedAST.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const uint32_t MappedAST::Version;
+
+namespace {
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t nodes;
+    uint32_t lists;
+    uint32_t strings;
+    uint32_t names;
+    uint32_t root;
+    uint32_t textBytes;
+};
+
+const char Magic[4] = {'D', 'A', 'S', 'T'};
+
+// Offsets of the sections, which follow from the counts in the header
+struct FileLayout {
+    explicit FileLayout(const FileHeader& header) {
+        size_t nodes = header.nodes;
+        lines = sizeof(FileHeader);
+        columns = lines + nodes * sizeof(int32_t);
+        first = columns + nodes * sizeof(int32_t);
+        second = first + nodes * sizeof(uint32_t);
+        lists = second + nodes * sizeof(uint32_t);
+        textOffsets = lists + (size_t)header.lists * sizeof(NodeId);
+        kinds = textOffsets + ((size_t)header.strings + header.names + 1) * sizeof(uint32_t);
+        ops = kinds + nodes;
+        flags = ops + nodes;
+        text = flags + nodes;
+        end = text + header.textBytes;
+    }
+
+    size_t lines, columns, first, second, lists, textOffsets;
+    size_t kinds, ops, flags, text, end;
+};
+
+}
+
+MappedAST::MappedAST()
+    : kinds(nullptr), ops(nullptr), flags(nullptr), lines(nullptr), columns(nullptr),
+      first(nullptr), second(nullptr), lists(nullptr), root(FlatAST::NoNode),
+      nodes(0), stringCount(0), textOffsets(nullptr), textData(nullptr),
+      mapping(nullptr), mappingSize(0) {}
+
+MappedAST::~MappedAST() {
+    close();
+}
+
+void MappedAST::close() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+    nodes = 0;
+    root = FlatAST::NoNode;
+}
+
+bool MappedAST::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || (size_t)info.st_size < sizeof(FileHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    size_t fileSize = info.st_size;
+    void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    const char* base = static_cast<const char*>(mapped);
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    FileLayout layout(header);
+
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(base + layout.textOffsets);
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version ||
+        layout.end != fileSize || offsets[header.strings + header.names] != header.textBytes ||
+        (header.root >= header.nodes && header.root != FlatAST::NoNode)) {
+        munmap(mapped, fileSize);
+        return false;
+    }
+
+    mapping = mapped;
+    mappingSize = fileSize;
+    nodes = header.nodes;
+    root = header.root;
+    stringCount = header.strings;
+    lines = reinterpret_cast<const int32_t*>(base + layout.lines);
+    columns = reinterpret_cast<const int32_t*>(base + layout.columns);
+    first = reinterpret_cast<const uint32_t*>(base + layout.first);
+    second = reinterpret_cast<const uint32_t*>(base + layout.second);
+    lists = reinterpret_cast<const NodeId*>(base + layout.lists);
+    textOffsets = offsets;
+    kinds = reinterpret_cast<const FlatKind*>(base + layout.kinds);
+    ops = reinterpret_cast<const unsigned char*>(base + layout.ops);
+    flags = reinterpret_cast<const unsigned char*>(base + layout.flags);
+    textData = base + layout.text;
+    return true;
+}
+
+double MappedAST::doubleValue(NodeId node) const {
+    uint64_t bits = (uint64_t)second[node] << 32 | first[node];
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+template <typename T>
+static void write_array(std::FILE* file, const std::vector<T>& values) {
+    if (!values.empty()) {
+        std::fwrite(values.data(), sizeof(T), values.size(), file);
+    }
+}
+
+bool save_flat_ast(const FlatAST& flat, const std::string& path) {
+    // String constants, then every identifier name by symbol ID
+    std::vector<TextRef> texts(flat.strings);
+    for (uint32_t symbol = 0; symbol < flat.names.size(); symbol++) {
+        texts.push_back(flat.names.name(symbol));
+    }
+
+    std::vector<uint32_t> textOffsets;
+    textOffsets.reserve(texts.size() + 1);
+    uint64_t textBytes = 0;
+    for (const TextRef& text : texts) {
+        textOffsets.push_back(textBytes);
+        textBytes += text.size();
+    }
+    textOffsets.push_back(textBytes);
+    if (textBytes > UINT32_MAX) {
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = MappedAST::Version;
+    header.nodes = flat.size();
+    header.lists = flat.lists.size();
+    header.strings = flat.strings.size();
+    header.names = flat.names.size();
+    header.root = flat.root;
+    header.textBytes = textBytes;
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    std::fwrite(&header, sizeof(header), 1, file);
+    write_array(file, flat.lines);
+    write_array(file, flat.columns);
+    write_array(file, flat.first);
+    write_array(file, flat.second);
+    write_array(file, flat.lists);
+    write_array(file, textOffsets);
+    write_array(file, flat.kinds);
+    write_array(file, flat.ops);
+    write_array(file, flat.flags);
+    for (const TextRef& text : texts) {
+        std::fwrite(text.data(), 1, text.size(), file);
+    }
+
+    bool ok = !std::ferror(file);
+    return std::fclose(file) == 0 && ok;
+}
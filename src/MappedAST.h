@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+#include "FlatAST.h"
+
+// A FlatAST saved with save_flat_ast() and memory mapped back in. Loading
+// checks the header and the file size, then points the arrays straight
+// into the mapping: nothing is copied, scanned or parsed, so the cost does
+// not grow with the program.
+//
+// File layout, native byte order, every section 4-byte aligned:
+//
+//   Header
+//   lines, columns, first, second   int32 / uint32 per node
+//   lists                           NodeId per list entry
+//   textOffsets                     uint32 per string, then per name, + 1
+//   kinds, ops, flags               one byte per node
+//   text                            string constants, then identifier names
+//
+// Node IDs are indexes, so the file is position independent. The node
+// contents are trusted: the file is a cache of our own output, not input.
+class MappedAST {
+public:
+    MappedAST();
+    ~MappedAST();
+    MappedAST(const MappedAST&) = delete;
+    MappedAST& operator=(const MappedAST&) = delete;
+
+    static const uint32_t Version = 2;
+
+    // False if the file cannot be mapped or was not written by this version
+    bool open(const std::string& path);
+
+    size_t size() const { return nodes; }
+
+    const NodeId* listBegin(NodeId node) const { return lists + first[node]; }
+    const NodeId* listEnd(NodeId node) const { return lists + first[node] + second[node]; }
+
+    double doubleValue(NodeId node) const;
+
+    // Same as FlatAST::string() and FlatAST::name()
+    TextRef string(uint32_t index) const { return text(index); }
+    TextRef name(uint32_t symbol) const { return text(stringCount + symbol); }
+
+    const FlatKind* kinds;
+    const unsigned char* ops;
+    const unsigned char* flags;
+    const int32_t* lines;
+    const int32_t* columns;
+    const uint32_t* first;
+    const uint32_t* second;
+    const NodeId* lists;
+    NodeId root;
+
+private:
+    TextRef text(uint32_t index) const {
+        return TextRef(textData + textOffsets[index], textOffsets[index + 1] - textOffsets[index]);
+    }
+
+    void close();
+
+    size_t nodes;
+    uint32_t stringCount;
+    const uint32_t* textOffsets;
+    const char* textData;
+    void* mapping;
+    size_t mappingSize;
+};
+
+// Writes flat to path in the format MappedAST reads, false on failure
+bool save_flat_ast(const FlatAST& flat, const std::string& path);
@@ -0,0 +1,74 @@
+#include "OutputBuffer.h"
+
+const int OutputBuffer::SpaceRun;
+const char OutputBuffer::spaceRun[SpaceRun + 1] =
+    "                                                                "
+    "                                                                ";
+
+OutputBuffer::OutputBuffer(FILE* file) : file(file), used(0) {}
+
+OutputBuffer::~OutputBuffer() {
+    flush();
+}
+
+void OutputBuffer::drain() {
+    if (used > 0) {
+        std::fwrite(block, 1, used, file);
+        used = 0;
+    }
+}
+
+void OutputBuffer::flush() {
+    drain();
+    std::fflush(file);
+}
+
+void OutputBuffer::writeLarge(const char* text, size_t length) {
+    // Top up the block first so the output stays in order, then write
+    // whatever is left straight through if it would not fit anyway
+    size_t head = Capacity - used;
+    std::memcpy(block + used, text, head);
+    used = Capacity;
+    drain();
+    text += head;
+    length -= head;
+    if (length >= Capacity) {
+        std::fwrite(text, 1, length, file);
+        return;
+    }
+    std::memcpy(block, text, length);
+    used = length;
+}
+
+void OutputBuffer::writeInt(long long value) {
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    // Work in unsigned so the most negative value does not overflow
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) {
+        *--p = '-';
+    }
+    write(p, end - p);
+}
+
+void OutputBuffer::writeDouble(double value) {
+    char digits[512];
+    write(digits, format_double(value, digits, sizeof(digits)));
+}
+
+void OutputBuffer::fill(char c, size_t count) {
+    while (count > 0) {
+        if (used == Capacity) {
+            drain();
+        }
+        size_t run = Capacity - used < count ? Capacity - used : count;
+        std::memset(block + used, c, run);
+        used += run;
+        count -= run;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include "Token.h"
+
+// Collects output in one large block and hands it to a FILE in big writes,
+// instead of going through iostreams and flushing on every std::endl.
+// Numbers are formatted directly into the block.
+//
+// Writes to the FILE happen only on flush(), when the block fills up, and on
+// destruction, so anything else printing to the same FILE has to wait for a
+// flush() to keep the output in order.
+class OutputBuffer {
+public:
+    explicit OutputBuffer(FILE* file = stdout);
+    ~OutputBuffer();
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void put(char c) {
+        if (used == Capacity) {
+            drain();
+        }
+        block[used++] = c;
+    }
+
+    void write(const char* text, size_t length) {
+        if (length > Capacity - used) {
+            writeLarge(text, length);
+            return;
+        }
+        std::memcpy(block + used, text, length);
+        used += length;
+    }
+
+    void write(const char* text) { write(text, std::strlen(text)); }
+    void write(const TextRef& text) { write(text.data(), text.size()); }
+
+    void writeInt(long long value);
+    void writeDouble(double value);
+
+    // count copies of c
+    void fill(char c, size_t count);
+
+    // count spaces, nothing if count is not positive. Copied from a static
+    // run of spaces, which covers the indentation of any sane listing.
+    void spaces(int count) {
+        while (count > 0) {
+            size_t run = count < SpaceRun ? count : SpaceRun;
+            write(spaceRun, run);
+            count -= run;
+        }
+    }
+
+    // Writes out the block and flushes the FILE
+    void flush();
+
+    static const size_t Capacity = 1 << 16;
+    static const int SpaceRun = 128;
+
+private:
+    void drain();
+    void writeLarge(const char* text, size_t length);
+
+    static const char spaceRun[SpaceRun + 1];
+
+    FILE* file;
+    size_t used;
+    char block[Capacity];
+};
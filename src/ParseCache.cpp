@@ -0,0 +1,104 @@
+#include "ParseCache.h"
+#include "MappedAST.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const uint32_t ParseCache::Version;
+
+// 64 bits of hash, a word at a time, so that hashing stays well below the
+// cost of scanning the same bytes
+static uint64_t hash_bytes(const char* data, size_t length) {
+    const uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+    uint64_t h = length * multiplier;
+    size_t k = 0;
+    for (; k + 8 <= length; k += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + k, sizeof(word));
+        h = (h ^ word) * multiplier;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + k, length - k);
+    h = (h ^ tail) * multiplier;
+    h ^= h >> 32;
+    return h;
+}
+
+ParseCache::ParseCache() {}
+
+void ParseCache::open(const std::string& path, const SourceFile& source) {
+    if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Cannot create cache directory " << path << std::endl;
+        return;
+    }
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx-%llx-v%u.%u",
+                  (unsigned long long)hash_bytes(source.data(), source.size()),
+                  (unsigned long long)source.size(), Version, MappedAST::Version);
+    directory = path;
+    key = name;
+}
+
+std::string ParseCache::entry(const char* kind) const {
+    return directory + "/" + key + "." + kind;
+}
+
+std::string ParseCache::temporary(const char* kind) const {
+    return entry(kind) + ".tmp" + std::to_string(getpid());
+}
+
+bool ParseCache::commit(const char* kind) const {
+    if (std::rename(temporary(kind).c_str(), entry(kind).c_str()) == 0) {
+        return true;
+    }
+    std::remove(temporary(kind).c_str());
+    return false;
+}
+
+bool ParseCache::replay(const char* kind, OutputBuffer& out) const {
+    SourceFile cached;
+    if (!cached.open(entry(kind))) {
+        return false;
+    }
+    out.write(cached.text());
+    return true;
+}
+
+// The counts are a line of text, updated under an exclusive lock since
+// parallel runs share the directory
+void ParseCache::record(bool hit, bool report) const {
+    std::string path = directory + "/stats";
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return;
+    }
+    flock(fd, LOCK_EX);
+
+    char text[64];
+    ssize_t length = pread(fd, text, sizeof(text) - 1, 0);
+    text[length > 0 ? length : 0] = '\0';
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+    std::sscanf(text, "%llu hits %llu misses", &hits, &misses);
+    (hit ? hits : misses)++;
+
+    length = std::snprintf(text, sizeof(text), "%llu hits %llu misses\n", hits, misses);
+    if (pwrite(fd, text, length, 0) == length) {
+        ftruncate(fd, length);
+    }
+    flock(fd, LOCK_UN);
+    ::close(fd);
+
+    if (report) {
+        std::cerr << "Cache " << (hit ? "hit" : "miss") << ", " << hits << " hits "
+                  << misses << " misses in " << directory << std::endl;
+    }
+}
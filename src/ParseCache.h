@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <stdint.h>
+#include "SourceFile.h"
+#include "OutputBuffer.h"
+
+// On-disk cache of the driver's results, keyed by the hash of the input
+// bytes, the input size and the compiler version, so an unchanged file is
+// neither scanned nor parsed again. Entries are files in one directory,
+// one per input and kind: "ast" holds the tree as save_flat_ast() wrote
+// it. The other kinds hold printed output: "tokens" the --testScanner
+// listing, "check" and "tac" the output of --check and --tac, and
+// "errors" and "allErrors" the syntax errors of an input that has some.
+//
+// Entries are written to a temporary file and renamed into place, so runs
+// sharing the directory never see half an entry. Hit and miss counts for
+// the directory are kept in its "stats" file.
+class ParseCache {
+public:
+    ParseCache();
+
+    // Bump whenever the listing or the token dump changes, so that old
+    // entries stop matching
+    static const uint32_t Version = 3;
+
+    // Hashes source and creates directory if needed. Without a call to
+    // open() the cache is disabled.
+    void open(const std::string& directory, const SourceFile& source);
+    bool enabled() const { return !directory.empty(); }
+
+    // Path of the entry of the given kind for this input
+    std::string entry(const char* kind) const;
+
+    // Copies the entry to out, false if there is none
+    bool replay(const char* kind, OutputBuffer& out) const;
+
+    // A new entry is written to the temporary() path, then commit() moves
+    // it into place
+    std::string temporary(const char* kind) const;
+    bool commit(const char* kind) const;
+
+    // Calls print with an OutputBuffer on a new entry of the given kind,
+    // then copies the entry to out. With the cache disabled, or when the
+    // entry cannot be written, print writes to out instead.
+    template <typename Print>
+    void store(const char* kind, OutputBuffer& out, Print print) const;
+
+    // Adds one hit or miss to the directory's counts. With report, the
+    // totals are printed to stderr.
+    void record(bool hit, bool report) const;
+
+private:
+    std::string directory;
+    std::string key;
+};
+
+template <typename Print>
+void ParseCache::store(const char* kind, OutputBuffer& out, Print print) const {
+    FILE* file = enabled() ? std::fopen(temporary(kind).c_str(), "wb") : nullptr;
+    if (!file) {
+        print(out);
+        return;
+    }
+    {
+        OutputBuffer entry(file);
+        print(entry);
+    }
+    std::fclose(file);
+    if (!commit(kind) || !replay(kind, out)) {
+        print(out);
+    }
+}
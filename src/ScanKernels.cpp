@@ -0,0 +1,218 @@
+#include "ScanKernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+// Scalar versions, also used for the tails the vector loops leave over
+
+static inline bool is_space(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static size_t skip_whitespace_scalar(const char* p, size_t n) {
+    size_t k = 0;
+    while (k < n && is_space(p[k])) {
+        k++;
+    }
+    return k;
+}
+
+static size_t find_either_scalar(const char* p, size_t n, char a, char b) {
+    size_t k = 0;
+    while (k < n && p[k] != a && p[k] != b) {
+        k++;
+    }
+    return k;
+}
+
+static size_t find_comment_end_scalar(const char* p, size_t n) {
+    for (size_t k = 0; k + 1 < n; k++) {
+        if (p[k] == '*' && p[k + 1] == '/') {
+            return k;
+        }
+    }
+    return n;
+}
+
+static size_t count_newlines_scalar(const char* p, size_t n, size_t* last_newline) {
+    size_t count = 0;
+    for (size_t k = 0; k < n; k++) {
+        if (p[k] == '\n') {
+            count++;
+            *last_newline = k;
+        }
+    }
+    return count;
+}
+
+#ifdef SCAN_KERNELS_X86
+
+// SSE2, 16 bytes per step
+
+__attribute__((target("sse2")))
+static size_t skip_whitespace_sse2(const char* p, size_t n) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i below = _mm_set1_epi8('\t' - 1);
+    const __m128i above = _mm_set1_epi8('\r' + 1);
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + k));
+        __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+                                  _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmplt_epi8(v, above)));
+        unsigned mask = ~(unsigned)_mm_movemask_epi8(ws) & 0xFFFFu;
+        if (mask) {
+            return k + __builtin_ctz(mask);
+        }
+    }
+    return k + skip_whitespace_scalar(p + k, n - k);
+}
+
+__attribute__((target("sse2")))
+static size_t find_either_sse2(const char* p, size_t n, char a, char b) {
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + k));
+        unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        if (mask) {
+            return k + __builtin_ctz(mask);
+        }
+    }
+    return k + find_either_scalar(p + k, n - k, a, b);
+}
+
+__attribute__((target("sse2")))
+static size_t find_comment_end_sse2(const char* p, size_t n) {
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i slash = _mm_set1_epi8('/');
+    size_t k = 0;
+    for (; k + 17 <= n; k += 16) {
+        __m128i first = _mm_loadu_si128((const __m128i*)(p + k));
+        __m128i second = _mm_loadu_si128((const __m128i*)(p + k + 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, star), _mm_cmpeq_epi8(second, slash)));
+        if (mask) {
+            return k + __builtin_ctz(mask);
+        }
+    }
+    size_t rest = find_comment_end_scalar(p + k, n - k);
+    return rest == n - k ? n : k + rest;
+}
+
+__attribute__((target("sse2")))
+static size_t count_newlines_sse2(const char* p, size_t n, size_t* last_newline) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t count = 0;
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + k));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        if (mask) {
+            count += __builtin_popcount(mask);
+            *last_newline = k + 31 - __builtin_clz(mask);
+        }
+    }
+    size_t last = 0;
+    size_t tail = count_newlines_scalar(p + k, n - k, &last);
+    if (tail) {
+        count += tail;
+        *last_newline = k + last;
+    }
+    return count;
+}
+
+// AVX2, 32 bytes per step
+
+__attribute__((target("avx2")))
+static size_t skip_whitespace_avx2(const char* p, size_t n) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i below = _mm256_set1_epi8('\t' - 1);
+    const __m256i above = _mm256_set1_epi8('\r' + 1);
+    size_t k = 0;
+    for (; k + 32 <= n; k += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + k));
+        __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                                     _mm256_and_si256(_mm256_cmpgt_epi8(v, below), _mm256_cmpgt_epi8(above, v)));
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(ws);
+        if (mask) {
+            return k + __builtin_ctz(mask);
+        }
+    }
+    return k + skip_whitespace_sse2(p + k, n - k);
+}
+
+__attribute__((target("avx2")))
+static size_t find_either_avx2(const char* p, size_t n, char a, char b) {
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    size_t k = 0;
+    for (; k + 32 <= n; k += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + k));
+        unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+        if (mask) {
+            return k + __builtin_ctz(mask);
+        }
+    }
+    return k + find_either_sse2(p + k, n - k, a, b);
+}
+
+__attribute__((target("avx2")))
+static size_t find_comment_end_avx2(const char* p, size_t n) {
+    const __m256i star = _mm256_set1_epi8('*');
+    const __m256i slash = _mm256_set1_epi8('/');
+    size_t k = 0;
+    for (; k + 33 <= n; k += 32) {
+        __m256i first = _mm256_loadu_si256((const __m256i*)(p + k));
+        __m256i second = _mm256_loadu_si256((const __m256i*)(p + k + 1));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, star), _mm256_cmpeq_epi8(second, slash)));
+        if (mask) {
+            return k + __builtin_ctz(mask);
+        }
+    }
+    size_t rest = find_comment_end_sse2(p + k, n - k);
+    return rest == n - k ? n : k + rest;
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t count_newlines_avx2(const char* p, size_t n, size_t* last_newline) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t count = 0;
+    size_t k = 0;
+    for (; k + 32 <= n; k += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + k));
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+        if (mask) {
+            count += __builtin_popcount(mask);
+            *last_newline = k + 31 - __builtin_clz(mask);
+        }
+    }
+    size_t last = 0;
+    size_t tail = count_newlines_sse2(p + k, n - k, &last);
+    if (tail) {
+        count += tail;
+        *last_newline = k + last;
+    }
+    return count;
+}
+
+#endif
+
+static ScanKernels select_scan_kernels() {
+#ifdef SCAN_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        return {"avx2", skip_whitespace_avx2, find_either_avx2, find_comment_end_avx2, count_newlines_avx2};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {"sse2", skip_whitespace_sse2, find_either_sse2, find_comment_end_sse2, count_newlines_sse2};
+    }
+#endif
+    return {"scalar", skip_whitespace_scalar, find_either_scalar, find_comment_end_scalar, count_newlines_scalar};
+}
+
+const ScanKernels& scan_kernels() {
+    static const ScanKernels kernels = select_scan_kernels();
+    return kernels;
+}
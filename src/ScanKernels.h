@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+// Byte scanning loops used by the Scanner for the long runs of input it skips
+// over: whitespace, comment bodies and string bodies. The implementation is
+// picked once at startup, AVX2 or SSE2 when the CPU has them and a scalar
+// loop otherwise.
+struct ScanKernels {
+    const char* name;
+
+    // Index of the first byte in [p, p + n) that is not whitespace, or n
+    size_t (*skip_whitespace)(const char* p, size_t n);
+
+    // Index of the first byte in [p, p + n) equal to a or b, or n
+    size_t (*find_either)(const char* p, size_t n, char a, char b);
+
+    // Index of the first "*/" that lies entirely inside [p, p + n), or n
+    size_t (*find_comment_end)(const char* p, size_t n);
+
+    // Number of '\n' bytes in [p, p + n). When there is at least one,
+    // last_newline is set to the index of the last of them.
+    size_t (*count_newlines)(const char* p, size_t n, size_t* last_newline);
+};
+
+const ScanKernels& scan_kernels();
@@ -1,76 +1,339 @@
 #include "Scanner.h"
 #include <iostream> // For debugging
+#include <algorithm>
 #include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
 
 #define MAX_IDENTIFIER_LENGTH 31
 
-bool Scanner::check_for_reserve_op(const std::string& content, const std::string& token, const TokenType& type) {
-    if (content.substr(this->i, token.size()) == token) {
-        // Check if the next character is NOT alphanumeric or underscore
-        int next_char_index = this->i + token.size();
-        if (next_char_index < content.size()) {
-            char next_char = content[next_char_index];
-            if (std::isalnum(next_char) || next_char == '_') {
-                return false; // It's part of a larger identifier
+// Character classes driving the scanner's state machine. Every byte of the
+// input is classified once through a 256 entry table instead of a chain of
+// std::isalpha/std::isdigit/substr comparisons.
+enum CharClass : unsigned char {
+    C_Other,
+    C_Newline,
+    C_Space,
+    C_Alpha,    // Letters and underscore, starts an identifier or keyword
+    C_Digit,
+    C_Operator, // Starts a one or two character operator
+    C_Slash,    // Operator, or the start of a comment
+    C_Quote,
+    C_Hash
+};
+
+struct CharTable {
+    unsigned char cls[256];
+    bool word[256];            // Characters allowed inside an identifier
+    char pairSecond[256];      // Second character of the two character operator starting with c
+    TokenType pairType[256];
+    TokenType singleType[256]; // Punctuator c on its own, T_Unknown if none
+
+    CharTable() {
+        for (int c = 0; c < 256; c++) {
+            cls[c] = C_Other;
+            word[c] = false;
+            pairSecond[c] = '\0';
+            pairType[c] = TokenType::T_Unknown;
+            singleType[c] = TokenType::T_Unknown;
+        }
+        for (int c = 'a'; c <= 'z'; c++) cls[c] = C_Alpha;
+        for (int c = 'A'; c <= 'Z'; c++) cls[c] = C_Alpha;
+        for (int c = '0'; c <= '9'; c++) cls[c] = C_Digit;
+        cls['_'] = C_Alpha;
+        for (int c = 0; c < 256; c++) word[c] = cls[c] == C_Alpha || cls[c] == C_Digit;
+
+        cls[' '] = cls['\t'] = cls['\v'] = cls['\f'] = cls['\r'] = C_Space;
+        cls['\n'] = C_Newline;
+        cls['"'] = C_Quote;
+        cls['#'] = C_Hash;
+
+        addSingle('+', TokenType::T_Plus);
+        addSingle('-', TokenType::T_Minus);
+        addSingle('*', TokenType::T_Star);
+        addSingle('/', TokenType::T_Slash);
+        addSingle('=', TokenType::T_Assign);
+        addSingle('<', TokenType::T_Less);
+        addSingle('>', TokenType::T_Greater);
+        addSingle('!', TokenType::T_Not);
+        addSingle('|', TokenType::T_Pipe);
+        addSingle('.', TokenType::T_Dot);
+        addSingle(';', TokenType::T_Semicolon);
+        addSingle(',', TokenType::T_Comma);
+        addSingle('{', TokenType::T_LeftBrace);
+        addSingle('}', TokenType::T_RightBrace);
+        addSingle('(', TokenType::T_LeftParen);
+        addSingle(')', TokenType::T_RightParen);
+        addSingle('%', TokenType::T_Percent);
+        cls['/'] = C_Slash;
+
+        addPair('|', '|', TokenType::T_Or);
+        addPair('<', '=', TokenType::T_LessEqual);
+        addPair('>', '=', TokenType::T_GreaterEqual);
+        addPair('=', '=', TokenType::T_Equal);
+        addPair('!', '=', TokenType::T_NotEqual);
+        addPair('&', '&', TokenType::T_And);
+    }
+
+    void addSingle(char c, TokenType type) {
+        cls[(unsigned char)c] = C_Operator;
+        singleType[(unsigned char)c] = type;
+    }
+
+    void addPair(char first, char second, TokenType type) {
+        cls[(unsigned char)first] = C_Operator;
+        pairSecond[(unsigned char)first] = second;
+        pairType[(unsigned char)first] = type;
+    }
+};
+
+static const CharTable chars;
+
+// Perfect hash over the reserved words: (first char + 13 * last char) mod 32
+// maps each of them to its own slot, so a lookup is one hash, one length
+// check and one memcmp.
+struct Keyword {
+    const char* text;
+    int length;
+    TokenType type;
+};
+
+static constexpr unsigned keyword_hash(const char* text, int length) {
+    return ((unsigned char)text[0] + 13u * (unsigned char)text[length - 1]) & 31u;
+}
+
+static constexpr Keyword keywords[32] = {
+    {nullptr, 0, TokenType::T_Identifier},
+    {nullptr, 0, TokenType::T_Identifier},
+    {nullptr, 0, TokenType::T_Identifier},
+    {nullptr, 0, TokenType::T_Identifier},
+    {nullptr, 0, TokenType::T_Identifier},
+    {"double", 6, TokenType::T_Double},
+    {"else", 4, TokenType::T_Else},
+    {"false", 5, TokenType::T_BoolConstant},
+    {"return", 6, TokenType::T_Return},
+    {nullptr, 0, TokenType::T_Identifier},
+    {"void", 4, TokenType::T_Void},
+    {nullptr, 0, TokenType::T_Identifier},
+    {nullptr, 0, TokenType::T_Identifier},
+    {"int", 3, TokenType::T_Int},
+    {"string", 6, TokenType::T_String},
+    {nullptr, 0, TokenType::T_Identifier},
+    {"for", 3, TokenType::T_For},
+    {"break", 5, TokenType::T_Break},
+    {nullptr, 0, TokenType::T_Identifier},
+    {"ReadLine", 8, TokenType::T_ReadLine},
+    {"Print", 5, TokenType::T_Print},
+    {"true", 4, TokenType::T_BoolConstant},
+    {nullptr, 0, TokenType::T_Identifier},
+    {"if", 2, TokenType::T_If},
+    {"while", 5, TokenType::T_While},
+    {nullptr, 0, TokenType::T_Identifier},
+    {nullptr, 0, TokenType::T_Identifier},
+    {nullptr, 0, TokenType::T_Identifier},
+    {"ReadInteger", 11, TokenType::T_ReadInteger},
+    {nullptr, 0, TokenType::T_Identifier},
+    {"bool", 4, TokenType::T_Bool},
+    {nullptr, 0, TokenType::T_Identifier},
+};
+
+// Checked at compile time: every keyword sits in the slot its hash selects
+static constexpr bool keyword_table_is_perfect(unsigned slot) {
+    return slot == 32 ||
+        ((keywords[slot].text == nullptr ||
+          keyword_hash(keywords[slot].text, keywords[slot].length) == slot) &&
+         keyword_table_is_perfect(slot + 1));
+}
+static_assert(keyword_table_is_perfect(0), "keyword table does not match keyword_hash");
+
+static const Keyword* lookup_keyword(const char* text, int length) {
+    const Keyword& keyword = keywords[keyword_hash(text, length)];
+    if (keyword.length == length && std::memcmp(keyword.text, text, length) == 0) {
+        return &keyword;
+    }
+    return nullptr;
+}
+
+void Scanner::add_token(TokenType type, int start, int length,
+                        int token_line, int token_column, ErrorType error) {
+    pending = {content.data() + start, length, token_line, token_column, type, error, false, {0}};
+    hasPending = true;
+}
+
+// Decaf ints are 32 bits, larger constants are flagged as overflowing
+static int decode_int(const char* text, int length, bool& overflow) {
+    long long value = 0;
+    overflow = false;
+    for (int k = 0; k < length; k++) {
+        value = value * 10 + (text[k] - '0');
+        if (value > INT_MAX) {
+            overflow = true;
+            return INT_MAX;
+        }
+    }
+    return value;
+}
+
+static const double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Double constants are digits, a period, optional digits and an optional
+// E+/E- exponent. When the significant digits fit in 53 bits and the decimal
+// exponent is at most 22 both are exact doubles, so a single correctly
+// rounded multiply or divide gives the exact result (Clinger's fast path).
+// Anything else goes to strtod.
+static double decode_double(const char* text, int length, bool& overflow) {
+    const uint64_t max_exact = 1ull << 53;
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    bool exact = true;
+
+    int k = 0;
+    for (; k < length && text[k] != '.' && text[k] != 'E'; k++) {
+        if (mantissa > max_exact / 10) {
+            exact = false;
+        }
+        mantissa = mantissa * 10 + (text[k] - '0');
+    }
+    if (k < length && text[k] == '.') {
+        for (k++; k < length && text[k] != 'E'; k++) {
+            if (mantissa > max_exact / 10) {
+                exact = false;
             }
+            mantissa = mantissa * 10 + (text[k] - '0');
+            exponent--;
         }
+    }
+    if (k < length && text[k] == 'E') {
+        bool negative = text[k + 1] == '-';
+        int power = 0;
+        for (k += 2; k < length && power < 100000; k++) {
+            power = power * 10 + (text[k] - '0');
+        }
+        exponent += negative ? -power : power;
+    }
 
-        Token t = {type, token, line, column, token.size()};
-        tokens.push_back(t);
-        column += token.size();
-        i += token.size();
-        return true;
+    double value;
+    if (exact && mantissa <= max_exact && exponent >= -22 && exponent <= 22) {
+        value = exponent >= 0 ? mantissa * exact_powers_of_ten[exponent]
+                              : mantissa / exact_powers_of_ten[-exponent];
+    } else {
+        value = std::strtod(std::string(text, length).c_str(), nullptr);
     }
-    return false;
+
+    overflow = std::isinf(value);
+    return value;
+}
+
+// Character at i + offset, or '\0' past the end of the input
+char Scanner::peek(int offset) const {
+    size_t index = i + offset;
+    return index < content.size() ? content[index] : '\0';
 }
 
-bool Scanner::tokenize_reserve_ops(const std::string& content) {
-
-    if(check_for_reserve_op(content, "void", TokenType::T_Void)) return true;
-    if(check_for_reserve_op(content, "int", TokenType::T_Int)) return true;
-    if(check_for_reserve_op(content, "double", TokenType::T_Double)) return true;
-    if(check_for_reserve_op(content, "string", TokenType::T_String)) return true;
-    if(check_for_reserve_op(content, "while", TokenType::T_While)) return true;
-    if(check_for_reserve_op(content, "if", TokenType::T_If)) return true;
-    if(check_for_reserve_op(content, "else", TokenType::T_Else)) return true;
-    if(check_for_reserve_op(content, "return", TokenType::T_Return)) return true;
-    if(check_for_reserve_op(content, "break", TokenType::T_Break)) return true;
-    if(check_for_reserve_op(content, "||", TokenType::T_Or)) return true;
-    if(check_for_reserve_op(content, "<=", TokenType::T_LessEqual)) return true;
-    if(check_for_reserve_op(content, ">=", TokenType::T_GreaterEqual)) return true;
-    if(check_for_reserve_op(content, "==", TokenType::T_Equal)) return true;
-    if(check_for_reserve_op(content, "true", TokenType::T_BoolConstant)) return true;
-    if(check_for_reserve_op(content, "false", TokenType::T_BoolConstant)) return true;
-    if(check_for_reserve_op(content, "bool", TokenType::T_Bool)) return true;
-    if(check_for_reserve_op(content, "Print", TokenType::T_Print)) return true;
-    if(check_for_reserve_op(content, "ReadInteger", TokenType::T_ReadInteger)) return true;
-    if(check_for_reserve_op(content, "ReadLine", TokenType::T_ReadLine)) return true;
-    if(check_for_reserve_op(content, "!=", TokenType::T_NotEqual)) return true;
-    if(check_for_reserve_op(content, "&&", TokenType::T_And)) return true;
-
-    if (content[i] == '+' || content[i] == '-' || content[i] == '*' || content[i] == '/' ||
-        content[i] == '=' || content[i] == '<' || content[i] == '>' || content[i] == '!' ||
-        content[i] == '|' || content[i] == '.' || content[i] == ';' || content[i] == ',' ||
-        content[i] == '{' || content[i] == '}' || content[i] == '(' || content[i] == ')' ||
-        content[i] == '%') {
-        int start = i;
+// Move past the next length characters, keeping line and column in step
+void Scanner::advance(size_t length) {
+    size_t last_newline = 0;
+    size_t newlines = kernels->count_newlines(content.data() + i, length, &last_newline);
+    if (newlines > 0) {
+        line += newlines;
+        column = length - last_newline;
+    }
+    else {
+        column += length;
+    }
+    i += length;
+}
+
+void Scanner::skip_whitespace() {
+    // Single separators are the common case, only longer runs go to the kernel
+    unsigned char next = peek(1);
+    if (chars.cls[next] != C_Space && chars.cls[next] != C_Newline) {
+        if (content[i] == '\n') {
+            line++;
+            column = 1;
+        }
+        else {
+            column++;
+        }
+        i++;
+        return;
+    }
+
+    advance(1 + kernels->skip_whitespace(content.data() + i + 1, limit - i - 1));
+}
+
+void Scanner::skip_block_comment() {
+    size_t body = i + 2;
+    size_t remaining = content.size() - body;
+    size_t end = kernels->find_comment_end(content.data() + body, remaining);
+
+    // An unterminated comment runs to the end of the file
+    size_t length = (end == remaining) ? content.size() - i : end + 4;
+    advance(length);
+}
+
+void Scanner::skip_line_comment() {
+    size_t length = kernels->find_either(content.data() + i, content.size() - i, '\n', '\n');
+    i += length;
+    column += length;
+}
+
+bool Scanner::tokenize_operator() {
+    unsigned char first = content[i];
+
+    if (chars.pairSecond[first] != '\0' && peek(1) == chars.pairSecond[first]) {
+        add_token(chars.pairType[first], i, 2, line, column);
+        i += 2;
+        column += 2;
+        return true;
+    }
+
+    if (chars.singleType[first] != TokenType::T_Unknown) {
+        add_token(chars.singleType[first], i, 1, line, column);
         i++;
         column++;
-        int length = 1;
-        std::string text = content.substr(start, length);
-        tokens.push_back({TokenType::T_Operator, text, line, column-length, length});
         return true;
     }
 
     return false;
 }
 
-void Scanner::tokenize_scientific_notation(const std::string& content) {
+// Identifier, or reserved word when the whole word matches one
+void Scanner::tokenize_word() {
+    int start = i;
+    int start_column = column;
+    while (chars.word[(unsigned char)peek(0)]) {
+        i++;
+        column++;
+    }
+    int length = i - start;
+
+    const Keyword* keyword = lookup_keyword(content.data() + start, length);
+    if (keyword) {
+        add_token(keyword->type, start, length, line, start_column);
+        if (keyword->type == TokenType::T_BoolConstant) {
+            pending.intValue = content[start] == 't';
+        }
+        return;
+    }
+
+    ErrorType error = length > MAX_IDENTIFIER_LENGTH ? ErrorType::E_IdentifierTooLong : ErrorType::E_None;
+    add_token(TokenType::T_Identifier, start, length, line, start_column, error);
+    pending.symbol = names.intern(content.data() + start, length);
+}
+
+void Scanner::tokenize_scientific_notation() {
     // Some doubles will have scientific notation
-    if(content[i] == 'E') {
+    if(peek(0) == 'E') {
         i++;
         column++;
-        if(content[i] == '+' || content[i] == '-') {
+        if(peek(0) == '+' || peek(0) == '-') {
             i++;
             column++;
         }
@@ -80,205 +343,312 @@ void Scanner::tokenize_scientific_notation(const std::string& content) {
             column -= 2;
             return;
         }
-        
+
         // Ignore scientific notation if it's not valid
-        if(!std::isdigit(content[i])) {
+        if(!std::isdigit(peek(0))) {
             i -= 2;
             column -=2;
             return;
         }
 
-        while(std::isdigit(content[i])) {
+        while(std::isdigit(peek(0))) {
             i++;
             column++;
         }
     }
 }
 
-bool Scanner::tokenize_double(const std::string& content) {
-    // Double constant
-    if (std::isdigit(content[i])) {
-        int start = i;
-        int start_column = column;
-        while(std::isdigit(content[i])) {
-            i++;
-            column++;
-        }
+// Integer constant, or double constant when the digits are followed by a period
+void Scanner::tokenize_number() {
+    int start = i;
+    int start_column = column;
+    while (chars.cls[(unsigned char)peek(0)] == C_Digit) {
+        i++;
+        column++;
+    }
 
-        if(content[i] == '.') {
-            i++;
-            column++;
-        }
-        // This is not a double if there is no period
-        else {
-            i = start;
-            column = start_column;
-            return false;
-        }
+    if (peek(0) != '.') {
+        int length = i - start;
+        add_token(TokenType::T_IntConstant, start, length, line, start_column);
+        pending.intValue = decode_int(content.data() + start, length, pending.overflow);
+        return;
+    }
 
-        // Handle numbers after period
-        while(std::isdigit(content[i])) {
-            i++;
-            column++;
-        }
+    i++;
+    column++;
+    while (chars.cls[(unsigned char)peek(0)] == C_Digit) {
+        i++;
+        column++;
+    }
 
-        tokenize_scientific_notation(content);
+    tokenize_scientific_notation();
 
-        int length = i - start;
-        std::string text = content.substr(start, length);
-        tokens.push_back({TokenType::T_DoubleConstant, text, line, start_column, length});
+    int length = i - start;
+    add_token(TokenType::T_DoubleConstant, start, length, line, start_column);
+    pending.doubleValue = decode_double(content.data() + start, length, pending.overflow);
+}
 
-        return true;
+void Scanner::tokenize_string() {
+    int start = i;
+    int start_line = line;
+    int start_column = column;
+    i++;
+    column++;
+
+    size_t body = kernels->find_either(content.data() + i, content.size() - i, '"', '\n');
+    i += body;
+    column += body;
+
+    // Strings must terminate on same line as they started
+    ErrorType error = ErrorType::E_None;
+    if(i >= (int)content.size() || content[i] == '\n') {
+        error = ErrorType::E_UnterminatedString;
     }
-    return false;
+
+    if(i < (int)content.size()) {
+        if(content[i] == '\n') {
+            line++;
+            column = 0;
+        }
+        i++;  // Skip closing quote or newline
+        column++;
+    }
+
+    int length = i - start;
+    add_token(TokenType::T_StringConstant, start, length, start_line, start_column, error);
+}
+
+// Directives are not supported, the whole line is reported as one token
+void Scanner::tokenize_directive() {
+    int start = i;
+    skip_line_comment();
+    int length = i - start;
+    add_token(TokenType::T_Unknown, start, length, line, start, ErrorType::E_InvalidDirective);
+}
+
+void Scanner::tokenize_unknown() {
+    add_token(TokenType::T_Unknown, i, 1, line, i, ErrorType::E_UnknownToken);
+    i++;
+    column++;
 }
 
 Scanner::Scanner() {
     i = 0;
     line = 1;
     column = 1;
-    tokens = std::vector<Token>();
+    limit = 0;
+    hasPending = false;
+    kernels = &scan_kernels();
 }
 
-// Scan string contents and return vector of tokens
-std::vector<Token> Scanner::tokenize(const std::string& content) {
+// Dispatch on the character at i. Consumes whitespace, a comment or one token.
+void Scanner::scan_step() {
+    switch (chars.cls[(unsigned char)content[i]]) {
+        case C_Newline:
+        case C_Space:
+            skip_whitespace();
+            break;
+        case C_Slash:
+            if (peek(1) == '*') {
+                skip_block_comment();
+            } else if (peek(1) == '/') {
+                skip_line_comment();
+            } else {
+                tokenize_operator();
+            }
+            break;
+        case C_Operator:
+            if (!tokenize_operator()) {
+                tokenize_unknown();
+            }
+            break;
+        case C_Alpha:
+            tokenize_word();
+            break;
+        case C_Digit:
+            tokenize_number();
+            break;
+        case C_Quote:
+            tokenize_string();
+            break;
+        case C_Hash:
+            tokenize_directive();
+            break;
+        default:
+            tokenize_unknown();
+            break;
+    }
+}
 
-    for(i = 0; i < content.size(); ) {
-        if(content[i] == '\n') {
-            line++;
-            i++;
-            column = 1;
-            continue;
-        }
+void Scanner::start(const TextRef& source) {
+    content = source;
+    i = 0;
+    line = 1;
+    column = 1;
+    limit = source.size();
+    hasPending = false;
+}
 
-        // Skip whitespace
-        if (std::isspace(content[i])) {
-            i++;
-            column++;
-            continue;
+// Scan up to the next token, false once the input is exhausted
+bool Scanner::next(Token& token) {
+    while (i < (int)content.size()) {
+        scan_step();
+        if (hasPending) {
+            hasPending = false;
+            token = pending;
+            return true;
         }
+    }
+    return false;
+}
 
-        // Handle multi line comment
-        if(content.substr(i, 2) == "/*"){
-            i += 2;
-            column += 2;
-
-            while(content.substr(i, 2) != "*/") {
-                if(content[i] == '\n') {
-                    line++;
-                    i++;
-                    column = 1;
-                }
-                else {
-                    i++;
-                    column++;
-                }
-            }
-            i += 2;
-            column += 2;
-            continue;
-        }
+// Scan string contents and return vector of tokens
+std::vector<Token> Scanner::tokenize(const TextRef& source) {
+    ThreadPool& pool = ThreadPool::shared();
+    if (source.size() >= ParallelThreshold && pool.size() > 1) {
+        return tokenize_parallel(source, pool, pool.size() * 4);
+    }
 
-        // Skip the line when a comment is encountered
-        if(content.substr(i, 2) == "//") {
-            while(content[i] != '\n') {
-                i++;
-                column++;
-            }
-            continue;
-        }
+    std::vector<Token> tokens;
+    start(source);
 
-        if(tokenize_reserve_ops(content)) continue;
+    Token token;
+    while (next(token)) {
+        tokens.push_back(token);
+    }
 
-        // Identifier
-        if (std::isalpha(content[i]) || content[i] == '_') {
-            int start = i;
-            int start_column = column;
-            while (std::isalnum(content[i]) || content[i] == '_') {
-                i++;
-                column++;
-            }
-            int length = i - start;
-            std::string text = content.substr(start, length);
+    return tokens;
+}
 
-            if(length > MAX_IDENTIFIER_LENGTH) {
-                Error error = {ErrorType::E_IdentifierTooLong, "Identifier too long: \"" + text + "\""};
-                tokens.push_back({TokenType::T_Identifier, text, line, column-length, length, error}); 
-            }
-            else {
-                tokens.push_back({TokenType::T_Identifier, text, line, start_column, length});
-            }
-            continue;
+// Scan [from, to) starting from the given position. Scanning stops at the
+// first token boundary at or past to, which is beyond it when a block
+// comment runs on into the following text.
+void Scanner::scan_range(int from, int to, int from_line, int from_column, std::vector<Token>& out) {
+    i = from;
+    line = from_line;
+    column = from_column;
+    limit = to;
+    hasPending = false;
+
+    while (i < to) {
+        scan_step();
+        if (hasPending) {
+            hasPending = false;
+            out.push_back(pending);
         }
+    }
+}
 
-        if(tokenize_double(content)) continue;
-
-        // Integer constant
-        if (std::isdigit(content[i]) && (content[i+1] != '.')) {
-            int start = i;
-            while (std::isdigit(content[i])) {
-                i++;
-                column++;
-            }
-            int length = i - start;
-            std::string text = content.substr(start, length);
-            tokens.push_back({TokenType::T_IntConstant, text, line, column-length, length});
-            continue;
+// Result of scanning one chunk on the assumption that it starts in plain code
+struct ScannedChunk {
+    int begin;            // Always the start of a line
+    int end;
+    int newlines;         // '\n' bytes in [begin, end)
+    std::vector<Token> tokens;
+    int exit;             // Where scanning stopped, past end if a comment ran over
+    int exitLine;         // Relative to the chunk, whose first line is 1
+    int exitColumn;
+    bool valid;           // False once the fix-up pass finds the assumption wrong
+    int lineBase;         // Newlines in front of the chunk
+    size_t outputOffset;
+    Interner names;       // Identifiers in the chunk, with chunk-local IDs
+    std::vector<uint32_t> symbols; // Chunk-local ID to global ID
+};
+
+// Chunks are cut after a newline, so the only thing that can carry over from
+// one chunk into the next is a block comment: strings, line comments and
+// directives all end at the newline. Every chunk is scanned speculatively
+// from its first byte. A serial pass then walks the chunks in order and,
+// where the previous chunk's last comment ran over into the next one,
+// rescans that chunk from the true position. Line numbers are made absolute
+// from the newline counts of the chunks in front, and identifiers are
+// interned per chunk, then merged into this Scanner's table in chunk order
+// so they get the same IDs a serial scan would give them.
+std::vector<Token> Scanner::tokenize_parallel(const TextRef& source, ThreadPool& pool, size_t chunks) {
+    const int size = source.size();
+    const char* data = source.data();
+
+    std::vector<ScannedChunk> pieces;
+    int step = std::max<int>(1, size / std::max<size_t>(1, chunks));
+    for (int begin = 0; begin < size; ) {
+        int end = std::min(size, begin + step);
+        if (end < size) {
+            const char* newline = static_cast<const char*>(std::memchr(data + end - 1, '\n', size - end + 1));
+            end = newline ? (newline - data) + 1 : size;
         }
+        ScannedChunk piece;
+        piece.begin = begin;
+        piece.end = end;
+        pieces.push_back(piece);
+        begin = end;
+    }
 
-        // String constant
-        if (content[i] == '"') {
-            int start = i;
-            int start_line = line;
-            int start_column = column;
-            i++;
-            column++;
-            
-            while (content[i] != '"' && content[i] != '\n') {
-                i++;
-                column++;
-            }
-
-            // Strings must terminate on same line as they started
-            Error error = {};
-            if(content[i] == '\n') {
-                error.type = ErrorType::E_UnterminatedString;
-                error.message = "Unterminated string constant";
-                line++;
-                column = 0;
+    pool.parallelFor(pieces.size(), [&](size_t k) {
+        ScannedChunk& piece = pieces[k];
+        size_t last_newline = 0;
+        piece.newlines = scan_kernels().count_newlines(data + piece.begin, piece.end - piece.begin, &last_newline);
+
+        Scanner scanner;
+        scanner.content = source;
+        scanner.scan_range(piece.begin, piece.end, 1, 1, piece.tokens);
+        piece.exit = scanner.i;
+        piece.exitLine = scanner.line;
+        piece.exitColumn = scanner.column;
+        piece.names = std::move(scanner.names);
+        piece.valid = true;
+    });
+
+    // Serial fix-up, cheap unless comments span chunk boundaries
+    int position = 0;
+    int line = 1;
+    int column = 1;
+    int lineBase = 0;
+    size_t total = 0;
+    for (ScannedChunk& piece : pieces) {
+        if (position == piece.begin) {
+            position = piece.exit;
+            line = piece.exitLine + lineBase;
+            column = piece.exitColumn;
+        } else {
+            piece.tokens.clear();
+            piece.names = Interner();
+            piece.valid = false;
+            if (position < piece.end) {
+                Scanner scanner;
+                scanner.content = source;
+                scanner.scan_range(position, piece.end, line, column, piece.tokens);
+                position = scanner.i;
+                line = scanner.line;
+                column = scanner.column;
+                piece.names = std::move(scanner.names);
             }
-
-            i++;  // Skip closing quote or newline
-            column++;
-            int length = i - start;
-            std::string text = content.substr(start, length);
-
-            // Subtract 1 from length and start_line to ignore
-            tokens.push_back({TokenType::T_StringConstant, text, start_line, start_column, length, error});
-            continue;
         }
+        piece.symbols.resize(piece.names.size());
+        for (uint32_t local = 0; local < piece.names.size(); local++) {
+            piece.symbols[local] = names.intern(piece.names.name(local));
+        }
+        piece.lineBase = lineBase;
+        piece.outputOffset = total;
+        total += piece.tokens.size();
+        lineBase += piece.newlines;
+    }
 
-        // Ignore directives
-        if (content[i] == '#') {
-            int start = i;
-            i++;
-            column++;
-            while(content[i] != '\n') {
-                i++;
-                column++;
+    // Stitch, speculative chunks still carry lines relative to their start
+    // and every chunk still carries its own symbol IDs
+    std::vector<Token> tokens(total);
+    pool.parallelFor(pieces.size(), [&](size_t k) {
+        const ScannedChunk& piece = pieces[k];
+        int offset = piece.valid ? piece.lineBase : 0;
+        Token* out = tokens.data() + piece.outputOffset;
+        for (const Token& token : piece.tokens) {
+            *out = token;
+            out->line += offset;
+            if (token.type == TokenType::T_Identifier) {
+                out->symbol = piece.symbols[token.symbol];
             }
-            int length = i - start; 
-            std::string directive_text = content.substr(start, length);
-            Error error = {ErrorType::E_InvalidDirective, "Invalid # directive"};
-            tokens.push_back({TokenType::T_Unknown, directive_text, line, start, length, error});
-            continue;
+            out++;
         }
-        
-        Error error = {ErrorType::E_UnknownToken, "Unknown token: \"" + content.substr(i, 1) + "\""};
-        tokens.push_back({TokenType::T_Unknown, content.substr(i, 1), line, i, 1, error});
-        this->i++;
-        this->column++;
-    }
+    });
 
     return tokens;
-}
\ No newline at end of file
+}
@@ -3,18 +3,53 @@
 #include <string>
 #include <vector>
 #include "Token.h"
+#include "ScanKernels.h"
+#include "ThreadPool.h"
+#include "Interner.h"
 
 class Scanner {
     private:
         int i; // Character index
         int column;
         int line;
-        std::vector<Token> tokens;
-        bool check_for_reserve_op(const std::string& content, const std::string& token, const TokenType& type);
-        bool tokenize_reserve_ops(const std::string& content);
-        void tokenize_scientific_notation(const std::string& content);
-        bool tokenize_double(const std::string& content);
+        TextRef content;
+        int limit; // Whitespace runs are not followed past this index
+        Token pending; // Token produced by the last scanning step
+        bool hasPending;
+        const ScanKernels* kernels;
+        Interner names; // Identifiers seen so far, kept across start() calls
+        void add_token(TokenType type, int start, int length,
+                       int token_line, int token_column, ErrorType error = ErrorType::E_None);
+        char peek(int offset) const;
+        void advance(size_t length);
+        void skip_whitespace();
+        void skip_block_comment();
+        void skip_line_comment();
+        bool tokenize_operator();
+        void tokenize_word();
+        void tokenize_scientific_notation();
+        void tokenize_number();
+        void tokenize_string();
+        void tokenize_directive();
+        void tokenize_unknown();
+        void scan_step();
+        void scan_range(int from, int to, int from_line, int from_column, std::vector<Token>& out);
     public:
         Scanner();
-        std::vector<Token> tokenize(const std::string& content);
+
+        // Pull interface: start() on a buffer, then next() until it returns false
+        void start(const TextRef& source);
+        bool next(Token& token);
+
+        // Scan the whole buffer at once. Large buffers are split into chunks
+        // that are scanned in parallel on the shared ThreadPool.
+        std::vector<Token> tokenize(const TextRef& source);
+
+        // Same tokens as a serial scan, from roughly chunks pieces scanned in parallel
+        std::vector<Token> tokenize_parallel(const TextRef& source, ThreadPool& pool, size_t chunks);
+
+        // Names behind the symbol IDs on identifier tokens
+        const Interner& symbols() const { return names; }
+
+        static const size_t ParallelThreshold = 1 << 20;
 };
@@ -0,0 +1,403 @@
+#include "SemanticChecker.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+const size_t SemanticChecker::ParallelThreshold;
+
+static std::string quoted(const TextRef& name) {
+    return "'" + name.str() + "'";
+}
+
+static std::string type_name(ASTNodeType* type) {
+    return type->typeName();
+}
+
+static std::string conflict_message(Identifier* id, Decl* previous) {
+    return "Declaration of " + quoted(id->name) + " here conflicts with declaration on line " +
+        std::to_string(previous->line);
+}
+
+static Identifier* declared_name(Decl* decl) {
+    if (decl->nodeKind == NodeKind::FunctionDecl) {
+        return static_cast<FunctionDecl*>(decl)->id;
+    }
+    return static_cast<VarDecl*>(decl)->id;
+}
+
+SemanticChecker::SemanticChecker(const SourceFile& source) : source(source) {}
+
+// The global table is complete before any body is looked at and only read
+// from then on, so the declarations can be checked in any order and on any
+// thread. Each range of declarations collects its own errors; they are
+// joined in range order and sorted stably, so the output does not depend
+// on the scheduling.
+void SemanticChecker::check(ASTRootNode* root) {
+    for (Decl* decl : root->decls) {
+        Identifier* id = declared_name(decl);
+        if (globals.declaredInScope(id->symbol)) {
+            errors.push_back(SemanticError{id->line, id->column, (int)id->name.size(),
+                                           conflict_message(id, *globals.lookup(id->symbol))});
+        } else {
+            globals.declare(id->symbol, decl);
+        }
+    }
+
+    const ArenaList<Decl*>& decls = root->decls;
+    ThreadPool& pool = ThreadPool::shared();
+    size_t ranges = 1;
+    if (source.size() >= ParallelThreshold && pool.size() > 1) {
+        ranges = std::max<size_t>(1, std::min(decls.size(), pool.size() * 4));
+    }
+
+    auto checkRange = [&](size_t k, std::vector<SemanticError>& out) {
+        BodyChecker checker(globals, out);
+        size_t end = decls.size() * (k + 1) / ranges;
+        for (size_t i = decls.size() * k / ranges; i < end; i++) {
+            checker.check(decls[i]);
+        }
+    };
+    if (ranges > 1) {
+        std::vector<std::vector<SemanticError>> found(ranges);
+        pool.parallelFor(ranges, [&](size_t k) { checkRange(k, found[k]); });
+        for (std::vector<SemanticError>& range : found) {
+            errors.insert(errors.end(), std::make_move_iterator(range.begin()),
+                          std::make_move_iterator(range.end()));
+        }
+    } else {
+        checkRange(0, errors);
+    }
+
+    std::stable_sort(errors.begin(), errors.end(),
+                     [](const SemanticError& a, const SemanticError& b) {
+                         return a.line != b.line ? a.line < b.line : a.column < b.column;
+                     });
+}
+
+void SemanticChecker::writeErrors(OutputBuffer& out) const {
+    for (const SemanticError& error : errors) {
+        out.write("\n*** Error line ");
+        out.writeInt(error.line);
+        out.write(".\n");
+        TextRef line = source.line(error.line);
+        out.write(line);
+        out.put('\n');
+        out.spaces(error.column - 1);
+        int width = error.width;
+        if (width == SemanticError::ToEndOfLine) {
+            width = std::max(1, (int)line.size() - error.column + 1);
+        }
+        out.fill('^', width);
+        out.write("\n*** ");
+        out.write(error.message.data(), error.message.size());
+        out.write("\n\n");
+    }
+}
+
+BodyChecker::BodyChecker(const GlobalTable& globals, std::vector<SemanticError>& errors)
+    : globals(globals), errors(errors), function(nullptr), loops(0) {}
+
+void BodyChecker::check(Decl* decl) {
+    schedule(decl);
+    run();
+}
+
+void BodyChecker::report(int line, int column, int width, const std::string& message) {
+    errors.push_back(SemanticError{line, column, width > 0 ? width : 1, message});
+}
+
+void BodyChecker::report(Identifier* id, const std::string& message) {
+    report(id->line, id->column, id->name.size(), message);
+}
+
+// Carets under the whole expression, up to the end of its first line
+void BodyChecker::reportSpan(Expr* expr, const std::string& message) {
+    if (expr->endLine != expr->line) {
+        errors.push_back(SemanticError{expr->line, expr->column, SemanticError::ToEndOfLine, message});
+        return;
+    }
+    report(expr->line, expr->column, expr->endColumn - expr->column + 1, message);
+}
+
+// Formals and locals may shadow globals, but not each other within a scope
+void BodyChecker::declare(Decl* decl, Identifier* id) {
+    if (locals.declaredInScope(id->symbol)) {
+        report(id, conflict_message(id, *locals.lookup(id->symbol)));
+        return;
+    }
+    locals.declare(id->symbol, decl);
+}
+
+Decl* const* BodyChecker::lookup(uint32_t symbol) const {
+    Decl* const* decl = locals.lookup(symbol);
+    return decl ? decl : globals.lookup(symbol);
+}
+
+void BodyChecker::checkTest(Expr* test) {
+    ASTNodeType* type = test->getType();
+    if (!type->isError() && type->kind != ASTNodeType::Bool) {
+        reportSpan(test, "Test expression must have boolean type");
+    }
+}
+
+void BodyChecker::visitFunctionDecl(FunctionDecl* fnDecl) {
+    if (task.step == 0) {
+        locals.enterScope();
+        for (VarDecl* formal : fnDecl->formals) {
+            declare(formal, formal->id);
+        }
+        function = fnDecl;
+        schedule(fnDecl, 1);
+        schedule(fnDecl->body);
+        return;
+    }
+
+    locals.exitScope();
+    function = nullptr;
+}
+
+// Globals are already in the global table, locals are declared once
+// their initializer is checked
+void BodyChecker::visitVarDecl(VarDecl* varDecl) {
+    if (task.step == 0) {
+        schedule(varDecl, 1);
+        schedule(varDecl->init);
+        return;
+    }
+
+    if (varDecl->init) {
+        ASTNodeType* type = varDecl->init->getType();
+        if (!type->isError() && !type->isAssignableTo(varDecl->type)) {
+            reportSpan(varDecl->init, "Incompatible operands: " + type_name(varDecl->type) +
+                       " = " + type_name(type));
+        }
+    }
+    if (locals.depth() > 0) {
+        declare(varDecl, varDecl->id);
+    }
+}
+
+void BodyChecker::visitVarDeclStmt(VarDeclStmt* stmt) {
+    schedule(stmt->varDecl);
+}
+
+void BodyChecker::visitExprStmt(ExprStmt* stmt) {
+    schedule(stmt->expr);
+}
+
+void BodyChecker::visitBlockStmt(BlockStmt* block) {
+    if (task.step == 0) {
+        locals.enterScope();
+        schedule(block, 1);
+        scheduleAll(block->stmts);
+        return;
+    }
+    locals.exitScope();
+}
+
+void BodyChecker::visitIfStmt(IfStmt* stmt) {
+    if (task.step == 0) {
+        schedule(stmt, 1);
+        schedule(stmt->cond);
+        return;
+    }
+    checkTest(stmt->cond);
+    schedule(stmt->elseStmt);
+    schedule(stmt->thenStmt);
+}
+
+// Step 1 enters the body, step 2 leaves it
+void BodyChecker::visitWhileStmt(WhileStmt* stmt) {
+    switch (task.step) {
+        case 0:
+            schedule(stmt, 1);
+            schedule(stmt->cond);
+            break;
+        case 1:
+            checkTest(stmt->cond);
+            loops++;
+            schedule(stmt, 2);
+            schedule(stmt->body);
+            break;
+        default:
+            loops--;
+            break;
+    }
+}
+
+void BodyChecker::visitForStmt(ForStmt* stmt) {
+    switch (task.step) {
+        case 0:
+            schedule(stmt, 1);
+            schedule(stmt->update);
+            schedule(stmt->cond);
+            schedule(stmt->init);
+            break;
+        case 1:
+            if (stmt->cond) {
+                checkTest(stmt->cond);
+            }
+            loops++;
+            schedule(stmt, 2);
+            schedule(stmt->body);
+            break;
+        default:
+            loops--;
+            break;
+    }
+}
+
+void BodyChecker::visitReturnStmt(ReturnStmt* stmt) {
+    if (task.step == 0 && stmt->expr) {
+        schedule(stmt, 1);
+        schedule(stmt->expr);
+        return;
+    }
+
+    ASTNodeType* given = stmt->expr ? stmt->expr->getType() : ASTNodeType::voidType;
+    ASTNodeType* expected = function ? function->returnType : ASTNodeType::voidType;
+    if (given->isError() || given->isAssignableTo(expected)) {
+        return;
+    }
+    std::string message = "Incompatible return: " + type_name(given) + " given, " +
+        type_name(expected) + " expected";
+    if (stmt->expr) {
+        reportSpan(stmt->expr, message);
+    } else {
+        report(stmt->line, stmt->column, std::strlen("return"), message);
+    }
+}
+
+void BodyChecker::visitBreakStmt(BreakStmt* stmt) {
+    if (loops == 0) {
+        report(stmt->line, stmt->column, std::strlen("break"), "break is only allowed inside a loop");
+    }
+}
+
+void BodyChecker::visitPrintStmt(PrintStmt* stmt) {
+    if (task.step == 0) {
+        schedule(stmt, 1);
+        scheduleAll(stmt->args);
+        return;
+    }
+
+    for (size_t k = 0; k < stmt->args.size(); k++) {
+        Expr* arg = stmt->args[k];
+        ASTNodeType* type = arg->getType();
+        if (type->isError() || type->kind == ASTNodeType::Int ||
+            type->kind == ASTNodeType::Bool || type->kind == ASTNodeType::String) {
+            continue;
+        }
+        reportSpan(arg, "Incompatible argument " + std::to_string(k + 1) + ": " + type_name(type) +
+                   " given, int/bool/string expected");
+    }
+}
+
+// A function's name is not a variable
+void BodyChecker::visitVarExpr(VarExpr* var) {
+    Decl* const* decl = lookup(var->id->symbol);
+    if (decl && (*decl)->nodeKind == NodeKind::VarDecl) {
+        var->varType = static_cast<VarDecl*>(*decl)->type;
+    } else {
+        report(var->id, "No declaration found for variable " + quoted(var->id->name));
+        var->varType = ASTNodeType::errorType;
+    }
+    var->annotate(var->varType);
+}
+
+void BodyChecker::visitBinaryExpr(BinaryExpr* binary) {
+    if (task.step == 0) {
+        schedule(binary, 1);
+        schedule(binary->right);
+        schedule(binary->left);
+        return;
+    }
+
+    ASTNodeType* left = binary->left->getType();
+    ASTNodeType* right = binary->right->getType();
+    if (left->isError() || right->isError()) {
+        binary->annotate(ASTNodeType::errorType);
+        return;
+    }
+
+    ASTNodeType* type = BinaryExpr::resultType(binary->op, left, right);
+    if (type->isError()) {
+        const char* op = BinaryExpr::operatorText(binary->op);
+        report(binary->opLine, binary->opColumn, std::strlen(op),
+               "Incompatible operands: " + type_name(left) + " " + op + " " + type_name(right));
+    }
+    binary->annotate(type);
+}
+
+void BodyChecker::visitUnaryExpr(UnaryExpr* unary) {
+    if (task.step == 0) {
+        schedule(unary, 1);
+        schedule(unary->expr);
+        return;
+    }
+
+    ASTNodeType* operand = unary->expr->getType();
+    ASTNodeType* type = UnaryExpr::resultType(unary->op, operand);
+    if (type->isError() && !operand->isError()) {
+        report(unary->line, unary->column, 1, std::string("Incompatible operand: ") +
+               (unary->op == UnaryExpr::Minus ? "- " : "! ") + type_name(operand));
+    }
+    unary->annotate(type);
+}
+
+// An assignment has the type of its target, even when the value does not fit
+void BodyChecker::visitAssignExpr(AssignExpr* assign) {
+    if (task.step == 0) {
+        schedule(assign, 1);
+        schedule(assign->right);
+        schedule(assign->left);
+        return;
+    }
+
+    ASTNodeType* left = assign->left->getType();
+    ASTNodeType* right = assign->right->getType();
+    if (!left->isError() && !right->isError() && !right->isAssignableTo(left)) {
+        report(assign->opLine, assign->opColumn, 1,
+               "Incompatible operands: " + type_name(left) + " = " + type_name(right));
+    }
+    assign->annotate(left);
+}
+
+// A variable's name is not a function. Arguments are only compared with
+// the formals when there are as many of them.
+void BodyChecker::visitCallExpr(CallExpr* call) {
+    if (task.step == 0) {
+        schedule(call, 1);
+        scheduleAll(call->args);
+        return;
+    }
+
+    Decl* const* decl = lookup(call->id->symbol);
+    if (!decl || (*decl)->nodeKind != NodeKind::FunctionDecl) {
+        report(call->id, "No declaration found for function " + quoted(call->id->name));
+        call->returnType = ASTNodeType::errorType;
+        call->annotate(call->returnType);
+        return;
+    }
+
+    FunctionDecl* callee = static_cast<FunctionDecl*>(*decl);
+    call->returnType = callee->returnType;
+    call->annotate(call->returnType);
+
+    if (call->args.size() != callee->formals.size()) {
+        report(call->id, "Function " + quoted(call->id->name) + " expects " +
+               std::to_string(callee->formals.size()) + " arguments but " +
+               std::to_string(call->args.size()) + " given");
+        return;
+    }
+
+    for (size_t k = 0; k < call->args.size(); k++) {
+        ASTNodeType* given = call->args[k]->getType();
+        ASTNodeType* expected = callee->formals[k]->type;
+        if (!given->isError() && !given->isAssignableTo(expected)) {
+            reportSpan(call->args[k], "Incompatible argument " + std::to_string(k + 1) + ": " +
+                       type_name(given) + " given, " + type_name(expected) + " expected");
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ASTVisitor.h"
+#include "SymbolTable.h"
+#include "SourceFile.h"
+#include "OutputBuffer.h"
+
+// A semantic error, written as
+//
+//   *** Error line <line>.
+//   <the source line>
+//   <carets under columns column to column + width - 1>
+//   *** <message>
+struct SemanticError {
+    static const int ToEndOfLine = 0; // Width of a span that runs past its line
+
+    int line;
+    int column;
+    int width;
+    std::string message;
+};
+
+// Every top-level function and variable, by symbol ID. Filled before any
+// body is checked and only read afterwards, so bodies can share it.
+typedef SymbolTable<Decl*> GlobalTable;
+
+// Checks one top-level declaration against the global table: scopes,
+// declarations and types inside it, with the diagnostics of the semantic
+// analyzer tests (samples/semantic_analyzer).
+//
+// One pass over the declaration, on a work stack (see ASTWorkStack), so the
+// cost is linear and any depth of nesting is fine. Every expression gets
+// its checked type (see Expr::annotate()); an expression whose operands are
+// already in error gets the error type without a diagnostic of its own, so
+// one mistake is reported once. Absent children of a partial tree are
+// skipped.
+//
+// Touches nothing outside the declaration but its errors, so checkers on
+// different declarations can run at the same time.
+class BodyChecker : public ASTWorkStack<BodyChecker> {
+public:
+    BodyChecker(const GlobalTable& globals, std::vector<SemanticError>& errors);
+
+    void check(Decl* decl);
+
+    void visitIdentifier(Identifier*) {}
+    void visitExpr(Expr* expr) { expr->annotate(); }
+    void visitVarExpr(VarExpr* var);
+    void visitBinaryExpr(BinaryExpr* binary);
+    void visitUnaryExpr(UnaryExpr* unary);
+    void visitCallExpr(CallExpr* call);
+    void visitAssignExpr(AssignExpr* assign);
+    void visitExprStmt(ExprStmt* stmt);
+    void visitBlockStmt(BlockStmt* block);
+    void visitIfStmt(IfStmt* stmt);
+    void visitWhileStmt(WhileStmt* stmt);
+    void visitForStmt(ForStmt* stmt);
+    void visitReturnStmt(ReturnStmt* stmt);
+    void visitBreakStmt(BreakStmt* stmt);
+    void visitPrintStmt(PrintStmt* stmt);
+    void visitVarDeclStmt(VarDeclStmt* stmt);
+    void visitVarDecl(VarDecl* varDecl);
+    void visitFunctionDecl(FunctionDecl* fnDecl);
+
+private:
+    void declare(Decl* decl, Identifier* id);
+    Decl* const* lookup(uint32_t symbol) const; // Locals, then globals
+    void checkTest(Expr* test);
+
+    void report(int line, int column, int width, const std::string& message);
+    void report(Identifier* id, const std::string& message);
+    void reportSpan(Expr* expr, const std::string& message);
+
+    const GlobalTable& globals;
+    std::vector<SemanticError>& errors;
+
+    SymbolTable<Decl*> locals;
+    FunctionDecl* function; // Whose body is being checked
+    int loops;              // Loops around the statement being checked
+};
+
+// Checks a whole program in two phases. The first enters every top-level
+// declaration into the global table, so functions can be called before
+// they are defined. The second checks each declaration with a BodyChecker,
+// on the shared ThreadPool for large programs.
+//
+// Errors are collected and sorted by position, writeErrors() prints them.
+class SemanticChecker {
+public:
+    explicit SemanticChecker(const SourceFile& source);
+
+    void check(ASTRootNode* root);
+
+    const std::vector<SemanticError>& semanticErrors() const { return errors; }
+    void writeErrors(OutputBuffer& out) const;
+
+    // Smaller sources are checked on the calling thread
+    static const size_t ParallelThreshold = 1 << 20;
+
+private:
+    const SourceFile& source;
+    GlobalTable globals;
+    std::vector<SemanticError> errors;
+};
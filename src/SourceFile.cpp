@@ -0,0 +1,120 @@
+#include "SourceFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceFile::SourceFile() : contents(""), length(0), mapping(nullptr), mappingSize(0) {}
+
+SourceFile::~SourceFile() {
+    close();
+}
+
+void SourceFile::close() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+    buffer.clear();
+    lineStarts.clear();
+    contents = "";
+    length = 0;
+}
+
+bool SourceFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    bool ok = true;
+    size_t fileSize = S_ISREG(info.st_mode) ? info.st_size : 0;
+    void* mapped = fileSize > 0 ? mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    if (mapped != MAP_FAILED && static_cast<const char*>(mapped)[fileSize - 1] == '\n') {
+        madvise(mapped, fileSize, MADV_SEQUENTIAL);
+        mapping = mapped;
+        mappingSize = fileSize;
+        contents = static_cast<const char*>(mapped);
+        length = fileSize;
+    } else {
+        if (mapped != MAP_FAILED) {
+            munmap(mapped, fileSize);
+        }
+        ok = readAll(fd, fileSize);
+    }
+
+    ::close(fd);
+    return ok;
+}
+
+// Fallback for files without a trailing newline and for pipes or anything
+// else that cannot be mapped. sizeHint is only used to size the buffer.
+bool SourceFile::readAll(int fd, size_t sizeHint) {
+    buffer.resize(sizeHint > 0 ? sizeHint + 1 : 65536);
+    size_t done = 0;
+    while (true) {
+        if (done == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+        ssize_t count = read(fd, &buffer[done], buffer.size() - done);
+        if (count < 0) {
+            buffer.clear();
+            return false;
+        }
+        if (count == 0) {
+            break;
+        }
+        done += count;
+    }
+    buffer.resize(done);
+    if (!buffer.empty() && buffer.back() != '\n') {
+        buffer.push_back('\n');
+    }
+    contents = buffer.data();
+    length = buffer.size();
+    return true;
+}
+
+void SourceFile::buildLineIndex() const {
+    lineStarts.push_back(0);
+    const char* end = contents + length;
+    const char* newline = static_cast<const char*>(memchr(contents, '\n', length));
+    while (newline) {
+        lineStarts.push_back(newline + 1 - contents);
+        newline = static_cast<const char*>(memchr(newline + 1, '\n', end - newline - 1));
+    }
+}
+
+TextRef SourceFile::line(int number) const {
+    if (lineStarts.empty()) {
+        buildLineIndex();
+    }
+
+    // The last entry is the end of the final line, not the start of a line
+    if (number < 1 || (size_t)number >= lineStarts.size()) {
+        return TextRef();
+    }
+
+    uint32_t begin = lineStarts[number - 1];
+    uint32_t end = lineStarts[number] - 1;
+    return TextRef(contents + begin, end - begin);
+}
+
+int SourceFile::lineAt(size_t offset) const {
+    if (lineStarts.empty()) {
+        buildLineIndex();
+    }
+    return std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "Token.h"
+
+// Read-only contents of a source file, shared by the Scanner, whose tokens
+// point into it, and by diagnostics that quote source lines.
+//
+// Files that end in a newline are memory mapped. Anything else is read once
+// into a single buffer with a newline appended, so the text handed to the
+// Scanner always ends in one, as it did when the file was read line by line.
+// Either way the file is held in memory exactly once.
+class SourceFile {
+public:
+    SourceFile();
+    ~SourceFile();
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    bool open(const std::string& path);
+
+    const char* data() const { return contents; }
+    size_t size() const { return length; }
+    TextRef text() const { return TextRef(contents, length); }
+
+    // Line number (1-based) without its newline, empty if there is no such line
+    TextRef line(int number) const;
+
+    // Line number (1-based) of the line containing the byte at offset
+    int lineAt(size_t offset) const;
+
+private:
+    bool readAll(int fd, size_t sizeHint);
+    void close();
+    void buildLineIndex() const;
+
+    const char* contents;
+    size_t length;
+    void* mapping;
+    size_t mappingSize;
+    std::string buffer;
+
+    // Offset of the first byte of every line, built on the first lookup so
+    // that runs without diagnostics never pay for it
+    mutable std::vector<uint32_t> lineStarts;
+};
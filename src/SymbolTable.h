@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+// Nested scopes mapping symbol IDs (see Interner) to a T, in two arrays
+// instead of a map per scope. Symbol IDs are dense, so the innermost
+// binding of every symbol is found by indexing, whatever the depth.
+//
+// Bindings are kept on a stack in order of declaration; each remembers the
+// binding of the same symbol it shadows. Leaving a scope pops the bindings
+// made since it was entered and puts the shadowed ones back, so entering
+// and leaving allocate nothing once the arrays have grown.
+template <typename T>
+class SymbolTable {
+public:
+    static const uint32_t NoBinding = 0xFFFFFFFFu;
+
+    void enterScope() {
+        scopeStarts.push_back(bindings.size());
+    }
+
+    // Leaving the outermost level, where no scope was entered, does nothing
+    void exitScope() {
+        if (scopeStarts.empty()) {
+            return;
+        }
+        size_t start = scopeStarts.back();
+        scopeStarts.pop_back();
+        while (bindings.size() > start) {
+            const Binding& binding = bindings.back();
+            innermost[binding.symbol] = binding.shadowed;
+            bindings.pop_back();
+        }
+    }
+
+    // A second declaration in the same scope replaces the first
+    void declare(uint32_t symbol, const T& value) {
+        if (symbol >= innermost.size()) {
+            innermost.resize(symbol + 1, NoBinding);
+        }
+        uint32_t top = innermost[symbol];
+        if (top != NoBinding && top >= scopeStart()) {
+            bindings[top].value = value;
+            return;
+        }
+        innermost[symbol] = bindings.size();
+        bindings.push_back(Binding{symbol, top, value});
+    }
+
+    // Innermost binding of symbol, null if there is none
+    const T* lookup(uint32_t symbol) const {
+        if (symbol >= innermost.size() || innermost[symbol] == NoBinding) {
+            return nullptr;
+        }
+        return &bindings[innermost[symbol]].value;
+    }
+
+    // Whether the innermost scope itself declares symbol
+    bool declaredInScope(uint32_t symbol) const {
+        return symbol < innermost.size() && innermost[symbol] != NoBinding &&
+            innermost[symbol] >= scopeStart();
+    }
+
+    // Number of scopes entered and not left
+    size_t depth() const { return scopeStarts.size(); }
+
+private:
+    struct Binding {
+        uint32_t symbol;
+        uint32_t shadowed; // Outer binding of the same symbol, or NoBinding
+        T value;
+    };
+
+    size_t scopeStart() const { return scopeStarts.empty() ? 0 : scopeStarts.back(); }
+
+    std::vector<Binding> bindings;    // Also the undo log of the scopes
+    std::vector<uint32_t> innermost;  // Indexed by symbol ID
+    std::vector<size_t> scopeStarts;  // Size of bindings when each scope was entered
+};
+
+template <typename T>
+const uint32_t SymbolTable<T>::NoBinding;
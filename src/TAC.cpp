@@ -0,0 +1,655 @@
+#include "TAC.h"
+#include "ASTVisitor.h"
+#include "SymbolTable.h"
+#include <utility>
+
+const uint32_t TACProgram::NoRegister;
+const uint32_t TACProgram::NoFunction;
+
+TACProgram::TACProgram() : labels(0), mainFunction(NoFunction) {}
+
+size_t TACProgram::emit(TACOp op, uint32_t dst, uint32_t a, uint32_t b) {
+    size_t index = ops.size();
+    ops.push_back(op);
+    dsts.push_back(dst);
+    lefts.push_back(a);
+    rights.push_back(b);
+    return index;
+}
+
+uint32_t TACProgram::newRegister(const TextRef& name) {
+    registerNames.push_back(name);
+    return registerNames.size() - 1;
+}
+
+// A node to lower, with the labels of the statement it is, if any
+struct LabelTask {
+    LabelTask(Node* node = nullptr, int step = 0, uint32_t first = 0, uint32_t second = 0)
+        : node(node), step(step), first(first), second(second) {}
+
+    Node* node;
+    int step;
+    uint32_t first;
+    uint32_t second;
+};
+
+// Lowers the tree on a work stack (see ASTWorkStack), so nesting
+// depth costs no native stack. Expressions are finished in postorder and
+// leave the register holding their value on a value stack, where their
+// parent picks it up. Statements that emit code between their children
+// come back at later steps, with their labels in the task.
+//
+// The code follows the reference compiler: every constant is loaded into
+// a fresh temporary, arguments are evaluated left to right and pushed
+// right to left, and <=, >, >=, != and ! are spelled with <, == and ||.
+class TACGenerator : public ASTWorkStack<TACGenerator, LabelTask> {
+public:
+    explicit TACGenerator(TACProgram& tac) : tac(tac), beginFunc(0), frameSlots(0) {}
+
+    void generate(ASTRootNode* root);
+
+    void visitIdentifier(Identifier*) {}
+    void visitIntLiteral(IntLiteral* literal);
+    void visitDoubleLiteral(DoubleLiteral* literal);
+    void visitBoolLiteral(BoolLiteral* literal);
+    void visitStringLiteral(StringLiteral* literal);
+    void visitNullLiteral(NullLiteral* literal);
+    void visitVarExpr(VarExpr* var);
+    void visitBinaryExpr(BinaryExpr* binary);
+    void visitUnaryExpr(UnaryExpr* unary);
+    void visitCallExpr(CallExpr* call);
+    void visitAssignExpr(AssignExpr* assign);
+    void visitReadIntegerExpr(ReadIntegerExpr* read);
+    void visitReadLineExpr(ReadLineExpr* read);
+    void visitExprStmt(ExprStmt* stmt);
+    void visitBlockStmt(BlockStmt* block);
+    void visitIfStmt(IfStmt* stmt);
+    void visitWhileStmt(WhileStmt* stmt);
+    void visitForStmt(ForStmt* stmt);
+    void visitReturnStmt(ReturnStmt* stmt);
+    void visitBreakStmt(BreakStmt* stmt);
+    void visitPrintStmt(PrintStmt* stmt);
+    void visitVarDeclStmt(VarDeclStmt* stmt);
+    void visitVarDecl(VarDecl* varDecl);
+    void visitFunctionDecl(FunctionDecl* fnDecl);
+
+private:
+    uint32_t temporary() {
+        frameSlots++;
+        return tac.newTemporary();
+    }
+
+    uint32_t load(TACOp op, uint32_t value) {
+        uint32_t reg = temporary();
+        tac.emit(op, reg, value);
+        return reg;
+    }
+
+    uint32_t compute(TACOp op, uint32_t left, uint32_t right) {
+        uint32_t reg = temporary();
+        tac.emit(op, reg, left, right);
+        return reg;
+    }
+
+    uint32_t pop() {
+        uint32_t reg = values.back();
+        values.pop_back();
+        return reg;
+    }
+
+    uint32_t lowerBinary(BinaryExpr::BinaryOp op, ASTNodeType* type, uint32_t left, uint32_t right);
+
+    TACProgram& tac;
+
+    std::vector<uint32_t> values;      // Registers of finished expressions
+    std::vector<uint32_t> breakLabels; // Ends of the enclosing loops
+    SymbolTable<uint32_t> variables;   // Register of each variable in scope
+    std::vector<uint32_t> functionOf;  // Function index by symbol ID
+    std::vector<std::pair<Expr*, uint32_t>> globalInits; // Initialized globals and their registers
+    size_t beginFunc;                  // BeginFunc of the function being lowered
+    uint32_t frameSlots;               // Its locals and temporaries so far
+};
+
+// Functions and globals first, so bodies can refer to any of them
+void TACGenerator::generate(ASTRootNode* root) {
+    for (Decl* decl : root->decls) {
+        if (decl->nodeKind == NodeKind::FunctionDecl) {
+            FunctionDecl* fnDecl = static_cast<FunctionDecl*>(decl);
+            uint32_t symbol = fnDecl->id->symbol;
+            if (symbol >= functionOf.size()) {
+                functionOf.resize(symbol + 1, TACProgram::NoFunction);
+            }
+            functionOf[symbol] = tac.functions.size();
+            if (fnDecl->id->name == "main") {
+                tac.mainFunction = tac.functions.size();
+            }
+            tac.functions.push_back(fnDecl->id->name);
+        } else {
+            VarDecl* global = static_cast<VarDecl*>(decl);
+            uint32_t reg = tac.newRegister(global->id->name);
+            variables.declare(global->id->symbol, reg);
+            if (global->init) {
+                globalInits.push_back(std::make_pair(global->init, reg));
+            }
+        }
+    }
+
+    for (size_t i = root->decls.size(); i > 0; i--) {
+        if (root->decls[i - 1]->nodeKind == NodeKind::FunctionDecl) {
+            schedule(root->decls[i - 1]);
+        }
+    }
+    run();
+}
+
+// The frame size is only known at the end, BeginFunc is patched then.
+// main starts with the initializers of the globals, in declaration order;
+// step 2 stores one of them, task.first being the global's register.
+void TACGenerator::visitFunctionDecl(FunctionDecl* fnDecl) {
+    if (task.step == 2) {
+        tac.emit(TACOp::Copy, task.first, pop());
+        return;
+    }
+
+    if (task.step == 0) {
+        variables.enterScope();
+        for (VarDecl* formal : fnDecl->formals) {
+            variables.declare(formal->id->symbol, tac.newRegister(formal->id->name));
+        }
+        beginFunc = tac.emit(TACOp::BeginFunc, TACProgram::NoRegister, functionOf[fnDecl->id->symbol]);
+        frameSlots = 0;
+        schedule(fnDecl, 1);
+        schedule(fnDecl->body);
+        if (functionOf[fnDecl->id->symbol] == tac.mainFunction) {
+            for (size_t i = globalInits.size(); i > 0; i--) {
+                schedule(fnDecl, 2, globalInits[i - 1].second);
+                schedule(globalInits[i - 1].first);
+            }
+        }
+        return;
+    }
+
+    tac.emit(TACOp::EndFunc);
+    tac.rights[beginFunc] = 4 * frameSlots;
+    variables.exitScope();
+}
+
+void TACGenerator::visitVarDecl(VarDecl* varDecl) {
+    if (task.step == 0) {
+        schedule(varDecl, 1);
+        schedule(varDecl->init);
+        return;
+    }
+
+    frameSlots++;
+    uint32_t reg = tac.newRegister(varDecl->id->name);
+    if (varDecl->init) {
+        tac.emit(TACOp::Copy, reg, pop());
+    }
+    variables.declare(varDecl->id->symbol, reg);
+}
+
+void TACGenerator::visitVarDeclStmt(VarDeclStmt* stmt) {
+    schedule(stmt->varDecl);
+}
+
+void TACGenerator::visitExprStmt(ExprStmt* stmt) {
+    if (task.step == 0) {
+        schedule(stmt, 1);
+        schedule(stmt->expr);
+        return;
+    }
+    pop();
+}
+
+void TACGenerator::visitBlockStmt(BlockStmt* block) {
+    if (task.step == 0) {
+        variables.enterScope();
+        schedule(block, 1);
+        scheduleAll(block->stmts);
+        return;
+    }
+    variables.exitScope();
+}
+
+// task.first is the else label, task.second the end label when there is an else
+void TACGenerator::visitIfStmt(IfStmt* stmt) {
+    switch (task.step) {
+        case 0:
+            schedule(stmt, 1);
+            schedule(stmt->cond);
+            break;
+        case 1: {
+            uint32_t elseLabel = tac.newLabel();
+            uint32_t endLabel = stmt->elseStmt ? tac.newLabel() : 0;
+            tac.emit(TACOp::IfZ, TACProgram::NoRegister, pop(), elseLabel);
+            schedule(stmt, 2, elseLabel, endLabel);
+            schedule(stmt->thenStmt);
+            break;
+        }
+        case 2:
+            if (stmt->elseStmt) {
+                tac.emit(TACOp::Goto, TACProgram::NoRegister, task.second);
+            }
+            tac.emit(TACOp::Label, TACProgram::NoRegister, task.first);
+            if (stmt->elseStmt) {
+                schedule(stmt, 3, task.first, task.second);
+                schedule(stmt->elseStmt);
+            }
+            break;
+        default:
+            tac.emit(TACOp::Label, TACProgram::NoRegister, task.second);
+            break;
+    }
+}
+
+// task.first is the label of the test, task.second the one after the loop
+void TACGenerator::visitWhileStmt(WhileStmt* stmt) {
+    switch (task.step) {
+        case 0: {
+            uint32_t top = tac.newLabel();
+            uint32_t end = tac.newLabel();
+            tac.emit(TACOp::Label, TACProgram::NoRegister, top);
+            schedule(stmt, 1, top, end);
+            schedule(stmt->cond);
+            break;
+        }
+        case 1:
+            tac.emit(TACOp::IfZ, TACProgram::NoRegister, pop(), task.second);
+            breakLabels.push_back(task.second);
+            schedule(stmt, 2, task.first, task.second);
+            schedule(stmt->body);
+            break;
+        default:
+            breakLabels.pop_back();
+            tac.emit(TACOp::Goto, TACProgram::NoRegister, task.first);
+            tac.emit(TACOp::Label, TACProgram::NoRegister, task.second);
+            break;
+    }
+}
+
+void TACGenerator::visitForStmt(ForStmt* stmt) {
+    switch (task.step) {
+        case 0:
+            schedule(stmt, 1);
+            schedule(stmt->init);
+            break;
+        case 1: {
+            if (stmt->init) {
+                pop();
+            }
+            uint32_t top = tac.newLabel();
+            uint32_t end = tac.newLabel();
+            tac.emit(TACOp::Label, TACProgram::NoRegister, top);
+            schedule(stmt, 2, top, end);
+            schedule(stmt->cond);
+            break;
+        }
+        case 2:
+            if (stmt->cond) {
+                tac.emit(TACOp::IfZ, TACProgram::NoRegister, pop(), task.second);
+            }
+            breakLabels.push_back(task.second);
+            schedule(stmt, 3, task.first, task.second);
+            schedule(stmt->body);
+            break;
+        case 3:
+            breakLabels.pop_back();
+            schedule(stmt, 4, task.first, task.second);
+            schedule(stmt->update);
+            break;
+        default:
+            if (stmt->update) {
+                pop();
+            }
+            tac.emit(TACOp::Goto, TACProgram::NoRegister, task.first);
+            tac.emit(TACOp::Label, TACProgram::NoRegister, task.second);
+            break;
+    }
+}
+
+void TACGenerator::visitReturnStmt(ReturnStmt* stmt) {
+    if (task.step == 0 && stmt->expr) {
+        schedule(stmt, 1);
+        schedule(stmt->expr);
+        return;
+    }
+    tac.emit(TACOp::Return, TACProgram::NoRegister, stmt->expr ? pop() : TACProgram::NoRegister);
+}
+
+void TACGenerator::visitBreakStmt(BreakStmt*) {
+    tac.emit(TACOp::Goto, TACProgram::NoRegister, breakLabels.back());
+}
+
+static TACBuiltin print_routine(ASTNodeType* type) {
+    switch (type->kind) {
+        case ASTNodeType::Bool: return TACBuiltin::PrintBool;
+        case ASTNodeType::String: return TACBuiltin::PrintString;
+        default: return TACBuiltin::PrintInt;
+    }
+}
+
+// Each argument is printed as soon as it is evaluated: step k prints
+// argument k - 1 and evaluates argument k
+void TACGenerator::visitPrintStmt(PrintStmt* stmt) {
+    if (task.step > 0) {
+        Expr* arg = stmt->args[task.step - 1];
+        tac.emit(TACOp::PushParam, TACProgram::NoRegister, pop());
+        tac.emit(TACOp::BuiltinCall, TACProgram::NoRegister, (uint32_t)print_routine(arg->getType()));
+        tac.emit(TACOp::PopParams, TACProgram::NoRegister, 4);
+    }
+    if ((size_t)task.step < stmt->args.size()) {
+        schedule(stmt, task.step + 1);
+        schedule(stmt->args[task.step]);
+    }
+}
+
+void TACGenerator::visitIntLiteral(IntLiteral* literal) {
+    values.push_back(load(TACOp::LoadInt, literal->value));
+}
+
+void TACGenerator::visitDoubleLiteral(DoubleLiteral* literal) {
+    tac.doubles.push_back(literal->value);
+    values.push_back(load(TACOp::LoadDouble, tac.doubles.size() - 1));
+}
+
+void TACGenerator::visitBoolLiteral(BoolLiteral* literal) {
+    values.push_back(load(TACOp::LoadInt, literal->value ? 1 : 0));
+}
+
+void TACGenerator::visitStringLiteral(StringLiteral* literal) {
+    tac.strings.push_back(literal->value);
+    values.push_back(load(TACOp::LoadString, tac.strings.size() - 1));
+}
+
+void TACGenerator::visitNullLiteral(NullLiteral*) {
+    values.push_back(load(TACOp::LoadInt, 0));
+}
+
+void TACGenerator::visitVarExpr(VarExpr* var) {
+    values.push_back(*variables.lookup(var->id->symbol));
+}
+
+uint32_t TACGenerator::lowerBinary(BinaryExpr::BinaryOp op, ASTNodeType* type, uint32_t left, uint32_t right) {
+    switch (op) {
+        case BinaryExpr::Plus: return compute(TACOp::Add, left, right);
+        case BinaryExpr::Minus: return compute(TACOp::Subtract, left, right);
+        case BinaryExpr::Multiply: return compute(TACOp::Multiply, left, right);
+        case BinaryExpr::Divide: return compute(TACOp::Divide, left, right);
+        case BinaryExpr::Modulo: return compute(TACOp::Modulo, left, right);
+        case BinaryExpr::Less: return compute(TACOp::Less, left, right);
+        case BinaryExpr::Greater: return compute(TACOp::Less, right, left);
+        case BinaryExpr::LessEqual: {
+            uint32_t less = compute(TACOp::Less, left, right);
+            return compute(TACOp::Or, less, compute(TACOp::Equal, left, right));
+        }
+        case BinaryExpr::GreaterEqual: {
+            uint32_t greater = compute(TACOp::Less, right, left);
+            return compute(TACOp::Or, greater, compute(TACOp::Equal, right, left));
+        }
+        case BinaryExpr::Equal:
+        case BinaryExpr::NotEqual: {
+            uint32_t equal;
+            if (type->kind == ASTNodeType::String) {
+                tac.emit(TACOp::PushParam, TACProgram::NoRegister, right);
+                tac.emit(TACOp::PushParam, TACProgram::NoRegister, left);
+                equal = temporary();
+                tac.emit(TACOp::BuiltinCall, equal, (uint32_t)TACBuiltin::StringEqual);
+                tac.emit(TACOp::PopParams, TACProgram::NoRegister, 8);
+            } else {
+                equal = compute(TACOp::Equal, left, right);
+            }
+            if (op == BinaryExpr::Equal) {
+                return equal;
+            }
+            return compute(TACOp::Equal, equal, load(TACOp::LoadInt, 0));
+        }
+        case BinaryExpr::And: return compute(TACOp::And, left, right);
+        default: return compute(TACOp::Or, left, right);
+    }
+}
+
+void TACGenerator::visitBinaryExpr(BinaryExpr* binary) {
+    if (task.step == 0) {
+        schedule(binary, 1);
+        schedule(binary->right);
+        schedule(binary->left);
+        return;
+    }
+    uint32_t right = pop();
+    uint32_t left = pop();
+    values.push_back(lowerBinary(binary->op, binary->left->getType(), left, right));
+}
+
+// -x is 0 - x and !x is x == 0
+void TACGenerator::visitUnaryExpr(UnaryExpr* unary) {
+    if (task.step == 0) {
+        schedule(unary, 1);
+        schedule(unary->expr);
+        return;
+    }
+    uint32_t operand = pop();
+    uint32_t zero = load(TACOp::LoadInt, 0);
+    if (unary->op == UnaryExpr::Minus) {
+        values.push_back(compute(TACOp::Subtract, zero, operand));
+    } else {
+        values.push_back(compute(TACOp::Equal, operand, zero));
+    }
+}
+
+// The value of an assignment is its target
+void TACGenerator::visitAssignExpr(AssignExpr* assign) {
+    if (task.step == 0) {
+        schedule(assign, 1);
+        schedule(assign->right);
+        schedule(assign->left);
+        return;
+    }
+    uint32_t value = pop();
+    uint32_t target = values.back();
+    tac.emit(TACOp::Copy, target, value);
+}
+
+// A void call leaves NoRegister as its value
+void TACGenerator::visitCallExpr(CallExpr* call) {
+    if (task.step == 0) {
+        schedule(call, 1);
+        scheduleAll(call->args);
+        return;
+    }
+
+    size_t count = call->args.size();
+    for (size_t i = values.size(); i > values.size() - count; i--) {
+        tac.emit(TACOp::PushParam, TACProgram::NoRegister, values[i - 1]);
+    }
+    values.resize(values.size() - count);
+
+    uint32_t result = call->getType()->isVoid() ? TACProgram::NoRegister : temporary();
+    tac.emit(TACOp::LCall, result, functionOf[call->id->symbol]);
+    if (count > 0) {
+        tac.emit(TACOp::PopParams, TACProgram::NoRegister, 4 * count);
+    }
+    values.push_back(result);
+}
+
+void TACGenerator::visitReadIntegerExpr(ReadIntegerExpr*) {
+    values.push_back(load(TACOp::BuiltinCall, (uint32_t)TACBuiltin::ReadInteger));
+}
+
+void TACGenerator::visitReadLineExpr(ReadLineExpr*) {
+    values.push_back(load(TACOp::BuiltinCall, (uint32_t)TACBuiltin::ReadLine));
+}
+
+void generate_tac(ASTRootNode* root, TACProgram& tac) {
+    TACGenerator(tac).generate(root);
+}
+
+static const char* builtin_name(TACBuiltin builtin) {
+    switch (builtin) {
+        case TACBuiltin::PrintInt: return "_PrintInt";
+        case TACBuiltin::PrintBool: return "_PrintBool";
+        case TACBuiltin::PrintString: return "_PrintString";
+        case TACBuiltin::ReadInteger: return "_ReadInteger";
+        case TACBuiltin::ReadLine: return "_ReadLine";
+        default: return "_StringEqual";
+    }
+}
+
+static const char* operator_text(TACOp op) {
+    switch (op) {
+        case TACOp::Add: return " + ";
+        case TACOp::Subtract: return " - ";
+        case TACOp::Multiply: return " * ";
+        case TACOp::Divide: return " / ";
+        case TACOp::Modulo: return " % ";
+        case TACOp::Less: return " < ";
+        case TACOp::Equal: return " == ";
+        case TACOp::And: return " && ";
+        default: return " || ";
+    }
+}
+
+// Temporaries are numbered in order of creation, which is register order
+// with the variables left out
+class TACPrinter {
+public:
+    TACPrinter(const TACProgram& tac, OutputBuffer& out) : tac(tac), out(out) {
+        uint32_t count = 0;
+        tempNumbers.reserve(tac.registerNames.size());
+        for (size_t reg = 0; reg < tac.registerNames.size(); reg++) {
+            tempNumbers.push_back(tac.isTemporary(reg) ? count++ : 0);
+        }
+    }
+
+    void print();
+
+private:
+    void writeRegister(uint32_t reg) {
+        if (tac.isTemporary(reg)) {
+            out.write("_tmp");
+            out.writeInt(tempNumbers[reg]);
+        } else {
+            out.write(tac.registerNames[reg]);
+        }
+    }
+
+    void writeLabel(uint32_t label) {
+        out.write("_L");
+        out.writeInt(label);
+    }
+
+    // main keeps its name, the others get an underscore
+    void writeFunction(uint32_t function) {
+        if (function != tac.mainFunction) {
+            out.put('_');
+        }
+        out.write(tac.functions[function]);
+    }
+
+    void writeDestination(uint32_t dst) {
+        if (dst != TACProgram::NoRegister) {
+            writeRegister(dst);
+            out.write(" = ");
+        }
+    }
+
+    const TACProgram& tac;
+    OutputBuffer& out;
+    std::vector<uint32_t> tempNumbers;
+};
+
+void TACPrinter::print() {
+    for (size_t i = 0; i < tac.size(); i++) {
+        TACOp op = tac.ops[i];
+        uint32_t dst = tac.dsts[i];
+        uint32_t a = tac.lefts[i];
+        uint32_t b = tac.rights[i];
+
+        if (op == TACOp::Label) {
+            writeLabel(a);
+            out.write(":\n");
+            continue;
+        }
+        if (op == TACOp::BeginFunc) {
+            writeFunction(a);
+            out.write(":\n");
+        }
+        out.put('\t');
+
+        switch (op) {
+            case TACOp::LoadInt:
+                writeDestination(dst);
+                out.writeInt((int32_t)a);
+                break;
+            case TACOp::LoadDouble:
+                writeDestination(dst);
+                out.writeDouble(tac.doubles[a]);
+                break;
+            case TACOp::LoadString:
+                writeDestination(dst);
+                out.write(tac.strings[a]);
+                break;
+            case TACOp::Copy:
+                writeDestination(dst);
+                writeRegister(a);
+                break;
+            case TACOp::Add: case TACOp::Subtract: case TACOp::Multiply:
+            case TACOp::Divide: case TACOp::Modulo: case TACOp::Less:
+            case TACOp::Equal: case TACOp::And: case TACOp::Or:
+                writeDestination(dst);
+                writeRegister(a);
+                out.write(operator_text(op));
+                writeRegister(b);
+                break;
+            case TACOp::Goto:
+                out.write("Goto ");
+                writeLabel(a);
+                break;
+            case TACOp::IfZ:
+                out.write("IfZ ");
+                writeRegister(a);
+                out.write(" Goto ");
+                writeLabel(b);
+                break;
+            case TACOp::BeginFunc:
+                out.write("BeginFunc ");
+                out.writeInt(b);
+                break;
+            case TACOp::EndFunc:
+                out.write("EndFunc");
+                break;
+            case TACOp::Return:
+                out.write("Return");
+                if (a != TACProgram::NoRegister) {
+                    out.put(' ');
+                    writeRegister(a);
+                }
+                break;
+            case TACOp::PushParam:
+                out.write("PushParam ");
+                writeRegister(a);
+                break;
+            case TACOp::PopParams:
+                out.write("PopParams ");
+                out.writeInt(a);
+                break;
+            case TACOp::LCall:
+                writeDestination(dst);
+                out.write("LCall ");
+                writeFunction(a);
+                break;
+            case TACOp::BuiltinCall:
+                writeDestination(dst);
+                out.write("LCall ");
+                out.write(builtin_name((TACBuiltin)a));
+                break;
+            default:
+                break;
+        }
+        out.put('\n');
+    }
+}
+
+void print_tac(const TACProgram& tac, OutputBuffer& out) {
+    TACPrinter(tac, out).print();
+}
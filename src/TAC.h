@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include "Token.h"
+#include "OutputBuffer.h"
+
+class ASTRootNode;
+
+enum class TACOp : unsigned char {
+    LoadInt,      // dst = a, an int or bool constant
+    LoadDouble,   // dst = doubles[a]
+    LoadString,   // dst = strings[a]
+    Copy,         // dst = a
+    Add,          // dst = a + b, likewise down to Or
+    Subtract,
+    Multiply,
+    Divide,
+    Modulo,
+    Less,
+    Equal,
+    And,
+    Or,
+    Label,        // a: label
+    Goto,         // a: label
+    IfZ,          // goto label b if a is zero
+    BeginFunc,    // a: function, b: bytes of locals and temporaries
+    EndFunc,
+    Return,       // a: value or NoRegister
+    PushParam,    // a: value
+    PopParams,    // a: bytes
+    LCall,        // dst (or NoRegister) = result of function a
+    BuiltinCall   // dst (or NoRegister) = result of TACBuiltin a
+};
+
+// Library routines called by the generated code
+enum class TACBuiltin : unsigned char {
+    PrintInt, PrintBool, PrintString, ReadInteger, ReadLine, StringEqual
+};
+
+// Three address code for a whole program: one linear list of instructions
+// in parallel arrays, each an opcode and up to three 32-bit operands.
+// Operands are virtual registers, labels or table indexes, depending on the
+// opcode (see TACOp).
+//
+// Registers are numbered from 0 across the program. A register is either a
+// variable, which has a name, or a temporary, which does not; temporaries
+// are listed as _tmp0, _tmp1... in order of creation, and labels as _L0,
+// _L1... Every function body starts with BeginFunc and ends with EndFunc.
+class TACProgram {
+public:
+    TACProgram();
+
+    static const uint32_t NoRegister = 0xFFFFFFFFu;
+    static const uint32_t NoFunction = 0xFFFFFFFFu;
+
+    size_t emit(TACOp op, uint32_t dst = NoRegister, uint32_t a = 0, uint32_t b = 0);
+
+    uint32_t newTemporary() { return newRegister(TextRef()); }
+    uint32_t newRegister(const TextRef& name);
+    uint32_t newLabel() { return labels++; }
+
+    size_t size() const { return ops.size(); }
+    bool isTemporary(uint32_t reg) const { return registerNames[reg].empty(); }
+
+    std::vector<TACOp> ops;
+    std::vector<uint32_t> dsts;
+    std::vector<uint32_t> lefts;  // Operand a
+    std::vector<uint32_t> rights; // Operand b
+
+    std::vector<TextRef> registerNames; // Empty for temporaries
+    std::vector<TextRef> functions;     // Source names, by function index
+    std::vector<TextRef> strings;       // String constants, with their quotes
+    std::vector<double> doubles;
+    uint32_t labels;
+    uint32_t mainFunction; // NoFunction if the program has no main
+};
+
+// Lowers a program that passed the SemanticChecker, whose expression types
+// it relies on
+void generate_tac(ASTRootNode* root, TACProgram& tac);
+
+// One line per instruction, as in the comments of samples/semantic_analyzer/*.s:
+// function and jump labels on their own line, instructions indented
+void print_tac(const TACProgram& tac, OutputBuffer& out);
@@ -0,0 +1,85 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threads) : current(nullptr), generation(0), stopping(false) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    for (size_t k = 1; k < threads; k++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::runTasks(Job& job) {
+    for (size_t index = job.next++; index < job.count; index = job.next++) {
+        (*job.task)(index);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    size_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+
+        // The job may already be over by the time this worker wakes up
+        Job* job = current;
+        if (!job) {
+            continue;
+        }
+        job->activeWorkers++;
+        lock.unlock();
+        runTasks(*job);
+        lock.lock();
+        if (--job->activeWorkers == 0) {
+            finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task) {
+    if (workers.empty() || count <= 1) {
+        for (size_t index = 0; index < count; index++) {
+            task(index);
+        }
+        return;
+    }
+
+    Job job;
+    job.task = &task;
+    job.count = count;
+    job.next = 0;
+    job.activeWorkers = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = &job;
+        generation++;
+    }
+    wake.notify_all();
+
+    runTasks(job);
+
+    // Every index has been claimed, wait for the workers still running one
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return job.activeWorkers == 0; });
+    current = nullptr;
+}
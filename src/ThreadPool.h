@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data parallel loops. parallelFor hands
+// out indices to the workers and the calling thread, and returns once every
+// index has been processed. Only one parallelFor may run at a time.
+class ThreadPool {
+public:
+    // threads counts the calling thread, 0 means one per hardware thread
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size() + 1; }
+
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+    // Pool shared by the compiler phases, created on first use
+    static ThreadPool& shared();
+
+private:
+    struct Job {
+        const std::function<void(size_t)>* task;
+        size_t count;
+        std::atomic<size_t> next;
+        int activeWorkers; // Guarded by mutex
+    };
+
+    void workerLoop();
+    static void runTasks(Job& job);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    Job* current;
+    size_t generation;
+    bool stopping;
+};
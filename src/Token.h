@@ -1,16 +1,37 @@
 #pragma once
 #include <string>
-#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
-#include <sstream>
+#include <stdint.h>
 
-enum class TokenType {
+enum class TokenType : unsigned char {
     T_Identifier,
     T_IntConstant,
     T_DoubleConstant,
     T_StringConstant,
     T_BoolConstant,
-    T_Operator,
+
+    // Single character punctuators, each its own kind. Kept together so
+    // is_punctuator() is a range check.
+    T_Plus,         // +
+    T_Minus,        // -
+    T_Star,         // *
+    T_Slash,        // /
+    T_Percent,      // %
+    T_Less,         // <
+    T_Greater,      // >
+    T_Assign,       // =
+    T_Not,          // !
+    T_Pipe,         // |
+    T_Dot,          // .
+    T_Semicolon,    // ;
+    T_Comma,        // ,
+    T_LeftBrace,    // {
+    T_RightBrace,   // }
+    T_LeftParen,    // (
+    T_RightParen,   // )
+
     T_Void,
     T_Int,
     T_Bool,
@@ -34,135 +55,116 @@ enum class TokenType {
     T_Unknown
 };
 
-enum class ErrorType {
+enum class ErrorType : unsigned char {
+    E_None,
     E_IdentifierTooLong,
     E_UnterminatedString,
     E_InvalidDirective,
     E_UnknownToken
 };
 
-struct Error {
-    ErrorType type;
-    std::string message;
+inline bool is_punctuator(TokenType type) {
+    return type >= TokenType::T_Plus && type <= TokenType::T_RightParen;
+}
+
+// Non-owning view of a run of characters, used in place of std::string_view
+class TextRef {
+public:
+    TextRef() : ptr(nullptr), len(0) {}
+    TextRef(const char* ptr, size_t len) : ptr(ptr), len(len) {}
+
+    const char* data() const { return ptr; }
+    size_t size() const { return len; }
+    size_t length() const { return len; }
+    bool empty() const { return len == 0; }
+    char operator[](size_t index) const { return ptr[index]; }
+    std::string str() const { return std::string(ptr, len); }
+
+    bool operator==(const char* other) const {
+        return std::strncmp(ptr, other, len) == 0 && other[len] == '\0';
+    }
+    bool operator!=(const char* other) const { return !(*this == other); }
+
+private:
+    const char* ptr;
+    size_t len;
 };
 
+inline std::ostream& operator<<(std::ostream& out, const TextRef& text) {
+    return out.write(text.data(), text.size());
+}
+
+// Tokens do not own their text, start points into the source buffer the
+// Scanner was given, which has to outlive them
 struct Token {
-    TokenType type;
-    std::string text;
+    const char* start;
+    int length;
     int line;
     int column;
-    int length;
-    Error error;
-};
-
-
-inline double convert_scientific_not_to_double(const std::string& double_str) {
-    size_t e_pos = double_str.find('E');
-    if (e_pos == std::string::npos) {
-        return std::stod(double_str);
-    }
-
-    std::string base_str = double_str.substr(0, e_pos);
-    double base = std::stod(base_str);
+    TokenType type;
+    ErrorType error;
+    bool overflow; // Literal value does not fit its type
 
-    std::string exponent_str = double_str.substr(e_pos + 1);
-    int exponent = std::stoi(exponent_str);
+    // Literal values, decoded once by the Scanner
+    union {
+        int intValue;       // T_IntConstant, and T_BoolConstant as 0 or 1
+        double doubleValue; // T_DoubleConstant
+        uint32_t symbol;    // T_Identifier, ID from the Scanner's Interner
+    };
 
-    return base * pow(10, exponent);
-}
-
-inline std::string convert_double_to_str(const double& num) {
-    std::stringstream ss;
-    ss << std::fixed << num;
-    std::string str = ss.str();
-
-    // Remove trailing zeros after the decimal point
-    size_t decimal_pos = str.find('.');
-    if (decimal_pos != std::string::npos) {
-        size_t last_non_zero = str.find_last_not_of('0');
-        if (last_non_zero != std::string::npos && last_non_zero > decimal_pos) {
-            str.erase(last_non_zero + 1);
-        } else if (last_non_zero == decimal_pos) {
-            str.erase(decimal_pos); // Remove decimal point if no digits after it
-        }
-    }
+    TextRef text() const { return TextRef(start, length); }
+};
 
-    // Remove leading zeros before the decimal point, but leave one 0 if the number is between -1 and 1 exclusive
-    if(decimal_pos != std::string::npos) {
-        size_t first_non_zero = str.find_first_not_of('0');
-        if(first_non_zero != std::string::npos && first_non_zero < decimal_pos) {
-            if(first_non_zero > 0 || str[0] == '-')
-                str.erase(0, first_non_zero);
-            else
-                str.erase(0, first_non_zero);
+// Formats like std::fixed, then drops trailing zeros and a trailing period.
+// Writes into buffer, which should hold at least 512 characters, and returns
+// the length written.
+inline size_t format_double(double num, char* buffer, size_t size) {
+    int written = std::snprintf(buffer, size, "%f", num);
+    size_t length = written < 0 ? 0 : (size_t)written < size ? (size_t)written : size - 1;
+
+    char* decimal = static_cast<char*>(std::memchr(buffer, '.', length));
+    if (decimal) {
+        while (buffer[length - 1] == '0') {
+            length--;
         }
-    }
-    else {
-        size_t first_non_zero = str.find_first_not_of('0');
-        if(first_non_zero != std::string::npos) {
-            if(first_non_zero > 0 || str[0] == '-')
-                str.erase(0, first_non_zero);
-            else
-                str.erase(0, first_non_zero);
+        if (buffer + length - 1 == decimal) {
+            length--;
         }
     }
-    
-    return str;
-}
 
-inline std::string remove_leading_zeros(const std::string& str) {
-    size_t first_non_zero = str.find_first_not_of('0');
-    if (first_non_zero == std::string::npos) {
-        return "0";
-    }
-    return str.substr(first_non_zero);
+    return length;
 }
 
-
-inline std::string token_to_string(Token token) {
-    switch (token.type) {
-        case TokenType::T_Identifier: return "T_Identifier";
-        case TokenType::T_IntConstant: return "T_IntConstant (value = " + remove_leading_zeros(token.text) + ")";
-        case TokenType::T_DoubleConstant: return "T_DoubleConstant (value = " + convert_double_to_str(convert_scientific_not_to_double(token.text)) + ")";
-        case TokenType::T_StringConstant: return "T_StringConstant (value = " + token.text + ")";
-        case TokenType::T_BoolConstant: return "T_BoolConstant (value = " + token.text + ")";
-        case TokenType::T_Operator: return "\'" + token.text + "\'";
-        case TokenType::T_Void: return "T_Void";
-        case TokenType::T_Int: return "T_Int";
-        case TokenType::T_Double: return "T_Double";
-        case TokenType::T_String: return "T_String";
-        case TokenType::T_While: return "T_While";
-        case TokenType::T_If: return "T_If";
-        case TokenType::T_Else: return "T_Else";
-        case TokenType::T_Return: return "T_Return";
-        case TokenType::T_Break: return "T_Break";
-        case TokenType::T_Or: return "T_Or";
-        case TokenType::T_LessEqual: return "T_LessEqual";
-        case TokenType::T_GreaterEqual: return "T_GreaterEqual";
-        case TokenType::T_Equal: return "T_Equal";
-        case TokenType::T_Print: return "T_Print";
-        case TokenType::T_ReadInteger: return "T_ReadInteger";
-        case TokenType::T_ReadLine: return "T_ReadLine";
-        case TokenType::T_Bool: return "T_Bool";
-        case TokenType::T_NotEqual: return "T_NotEqual";
-        case TokenType::T_And: return "T_And";
-        default: return "Unknown";
-    }
-}
-
-inline std::string token_type_to_string(TokenType type) {
+inline const char* token_type_name(TokenType type) {
     switch (type) {
         case TokenType::T_Identifier: return "T_Identifier";
         case TokenType::T_IntConstant: return "T_IntConstant";
         case TokenType::T_DoubleConstant: return "T_DoubleConstant";
         case TokenType::T_StringConstant: return "T_StringConstant";
         case TokenType::T_BoolConstant: return "T_BoolConstant";
-        case TokenType::T_Operator: return "T_Operator";
+        case TokenType::T_Plus: return "'+'";
+        case TokenType::T_Minus: return "'-'";
+        case TokenType::T_Star: return "'*'";
+        case TokenType::T_Slash: return "'/'";
+        case TokenType::T_Percent: return "'%'";
+        case TokenType::T_Less: return "'<'";
+        case TokenType::T_Greater: return "'>'";
+        case TokenType::T_Assign: return "'='";
+        case TokenType::T_Not: return "'!'";
+        case TokenType::T_Pipe: return "'|'";
+        case TokenType::T_Dot: return "'.'";
+        case TokenType::T_Semicolon: return "';'";
+        case TokenType::T_Comma: return "','";
+        case TokenType::T_LeftBrace: return "'{'";
+        case TokenType::T_RightBrace: return "'}'";
+        case TokenType::T_LeftParen: return "'('";
+        case TokenType::T_RightParen: return "')'";
         case TokenType::T_Void: return "T_Void";
         case TokenType::T_Int: return "T_Int";
         case TokenType::T_Double: return "T_Double";
         case TokenType::T_String: return "T_String";
         case TokenType::T_While: return "T_While";
+        case TokenType::T_For: return "T_For";
         case TokenType::T_If: return "T_If";
         case TokenType::T_Else: return "T_Else";
         case TokenType::T_Return: return "T_Return";
@@ -179,4 +181,8 @@ inline std::string token_type_to_string(TokenType type) {
         case TokenType::T_And: return "T_And";
         default: return "Unknown";
     }
-}
\ No newline at end of file
+}
+
+inline std::string token_type_to_string(TokenType type) {
+    return token_type_name(type);
+}
@@ -0,0 +1,125 @@
+#include "TokenDump.h"
+
+#define MAX_IDENTIFIER_LENGTH 31
+
+// Width of the lexeme column, based on the longest lexeme in string.out
+static const int LexemeWidth = 13;
+
+void TokenDump::write(const std::vector<Token>& tokens) {
+    for (const Token& token : tokens) {
+        write(token);
+    }
+}
+
+void TokenDump::write(const Token& token) {
+    if (token.error != ErrorType::E_None && token.error != ErrorType::E_UnknownToken) {
+        writeError(token);
+        return;
+    }
+
+    if (token.type != TokenType::T_Unknown) {
+        out.write(token.text());
+    }
+
+    // Add whitespace padding
+    int padding = LexemeWidth - token.length;
+    out.spaces(padding > 0 ? padding : 1);
+
+    if (token.type == TokenType::T_Unknown) {
+        out.put('\n');
+        writeErrorLine(token);
+        out.write("*** Unrecognized char: '");
+        out.write(token.text());
+        out.write("'\n\n");
+        return;
+    }
+
+    out.write("line ");
+    out.writeInt(token.line);
+    writeColumns(token);
+    out.write(" is ");
+    writeValue(token);
+    out.put('\n');
+}
+
+void TokenDump::writeErrorLine(const Token& token) {
+    out.write("*** Error line ");
+    out.writeInt(token.line);
+    out.write(".\n");
+}
+
+void TokenDump::writeColumns(const Token& token) {
+    out.write(" cols ");
+    out.writeInt(token.column);
+    out.put('-');
+    out.writeInt(token.column + token.length - 1);
+}
+
+void TokenDump::writeError(const Token& token) {
+    out.put('\n');
+    writeErrorLine(token);
+    out.write("*** ");
+
+    switch (token.error) {
+        case ErrorType::E_IdentifierTooLong:
+            out.write("Identifier too long: \"");
+            out.write(token.text());
+            out.write("\"\n\n");
+
+            // Truncate identifier to max length
+            out.write(token.text());
+            out.write(" line ");
+            out.writeInt(token.line);
+            writeColumns(token);
+            out.write(" is T_Identifier (truncated to ");
+            out.write(token.start, MAX_IDENTIFIER_LENGTH);
+            out.write(")\n");
+            break;
+        case ErrorType::E_UnterminatedString:
+            out.write("Unterminated string constant: ");
+            out.write(token.text());
+            out.put('\n');
+            break;
+        case ErrorType::E_InvalidDirective:
+            out.write("Invalid # directive\n\n");
+            break;
+        default:
+            break;
+    }
+}
+
+void TokenDump::writeValue(const Token& token) {
+    switch (token.type) {
+        case TokenType::T_IntConstant:
+            out.write("T_IntConstant (value = ");
+            if (token.overflow) {
+                // Too big to hold, print the digits without leading zeros
+                TextRef digits = token.text();
+                size_t first = 0;
+                while (first + 1 < digits.size() && digits[first] == '0') {
+                    first++;
+                }
+                out.write(digits.data() + first, digits.size() - first);
+            } else {
+                out.writeInt(token.intValue);
+            }
+            out.put(')');
+            break;
+        case TokenType::T_DoubleConstant:
+            out.write("T_DoubleConstant (value = ");
+            out.writeDouble(token.doubleValue);
+            out.put(')');
+            break;
+        case TokenType::T_StringConstant:
+        case TokenType::T_BoolConstant:
+            out.write(token_type_name(token.type));
+            out.write(" (value = ");
+            out.write(token.text());
+            out.put(')');
+            break;
+        default:
+            // Punctuators print as themselves in quotes
+            out.write(token_type_name(token.type));
+            break;
+    }
+}
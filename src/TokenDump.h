@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+#include "Token.h"
+#include "OutputBuffer.h"
+
+// Writes the --testScanner listing of a token stream: one line per token
+// with its position and type, and the scanner's error reports in between.
+class TokenDump {
+public:
+    explicit TokenDump(OutputBuffer& out) : out(out) {}
+
+    void write(const Token& token);
+    void write(const std::vector<Token>& tokens);
+
+private:
+    void writeError(const Token& token);
+    void writeErrorLine(const Token& token);
+    void writeColumns(const Token& token);
+    void writeValue(const Token& token);
+
+    OutputBuffer& out;
+};
@@ -0,0 +1,52 @@
+#include "TokenStream.h"
+
+const Token TokenStream::eofToken = {"EOF", 3, 0, 0, TokenType::T_Unknown, ErrorType::E_None, false, {0}};
+
+TokenStream::TokenStream(Scanner& scanner)
+    : head(0), count(0), scanner(&scanner), tokens(nullptr), replayIndex(0) {
+    fill(1);
+}
+
+TokenStream::TokenStream(const std::vector<Token>& tokens)
+    : head(0), count(0), scanner(nullptr), tokens(&tokens), replayIndex(0) {
+    fill(1);
+}
+
+bool TokenStream::pull(Token& token) {
+    if (scanner) {
+        return scanner->next(token);
+    }
+    if (replayIndex < tokens->size()) {
+        token = (*tokens)[replayIndex++];
+        return true;
+    }
+    return false;
+}
+
+// Top the window up to at least wanted tokens, unless the input runs out
+void TokenStream::fill(size_t wanted) {
+    while (count < wanted) {
+        Token& slot = ring[(head + count) & (Lookahead - 1)];
+        if (!pull(slot)) {
+            return;
+        }
+        count++;
+    }
+}
+
+const Token& TokenStream::peek(size_t k) {
+    if (k >= Lookahead) {
+        return eofToken;
+    }
+    fill(k + 1);
+    return k < count ? ring[(head + k) & (Lookahead - 1)] : eofToken;
+}
+
+void TokenStream::advance() {
+    if (count == 0) {
+        return;
+    }
+    head = (head + 1) & (Lookahead - 1);
+    count--;
+    fill(1);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include "Token.h"
+#include "Scanner.h"
+
+// Tokens for the parser, produced on demand. Pulled from a Scanner only as
+// far as the parser has looked ahead, so memory is bounded by the lookahead
+// window rather than by the size of the file. Can also replay a token vector
+// that was scanned up front.
+class TokenStream {
+public:
+    explicit TokenStream(Scanner& scanner);
+    explicit TokenStream(const std::vector<Token>& tokens);
+
+    // Token under the cursor, the EOF token once the input is exhausted
+    const Token& current() const { return count > 0 ? ring[head] : eofToken; }
+
+    // Token k positions past the cursor, at most Lookahead - 1
+    const Token& peek(size_t k);
+
+    void advance();
+    bool atEnd() const { return count == 0; }
+
+    static const Token eofToken;
+
+private:
+    static const size_t Lookahead = 8; // Power of two
+
+    bool pull(Token& token);
+    void fill(size_t wanted);
+
+    Token ring[Lookahead];
+    size_t head;
+    size_t count;
+
+    Scanner* scanner;
+    const std::vector<Token>* tokens;
+    size_t replayIndex;
+};
@@ -1,5 +1,4 @@
 #include <iostream>
-#include <fstream>
 #include <regex>
 #include <string>
 #include <algorithm>
@@ -8,103 +7,112 @@
 #include <cstring>
 
 #include "ASTBuilder.h"
+#include "TokenDump.h"
+#include "FlatAST.h"
+#include "MappedAST.h"
+#include "ParseCache.h"
+#include "ASTPrinter.h"
+#include "SemanticChecker.h"
+#include "TAC.h"
 
-#define MAX_IDENTIFIER_LENGTH 31
-
-void print_token_error(const Token& token) {
-
-    if(token.error.type == ErrorType::E_IdentifierTooLong) 
-    {
-        std::cout << std::endl << "*** Error line " << token.line << "." << std::endl
-        << "*** " << token.error.message << std::endl << std::endl; 
-
-        // Truncate identifier to max length
-        std::string truncated = token.text.substr(0, MAX_IDENTIFIER_LENGTH);
-        std::cout <<  token.text << " line " << token.line
-        << " cols " << token.column << "-" << token.column + token.length - 1
-        << " is T_Identifier (truncated to " << truncated << ")" << std::endl;
-
-        return;
-    }
+int main(int argc, char* argv[]) {
 
-    if(token.error.type == ErrorType::E_UnterminatedString)
-    {
-        std::cout << std::endl << "*** Error line " << token.line << "." << std::endl
-        << "*** " << token.error.message << ": " << token.text << std::endl; 
-        return;
+    if (argc <= 1) {
+        std::cerr << "Usage: " << argv[0] << " <input_file> [--testScanner] [--flatAST] [--allErrors] [--saveAST <file>] [--loadAST] [--cache <dir>] [--cacheStats] [--check] [--tac]" << std::endl;
+        return 1;
     }
 
-    if(token.error.type == ErrorType::E_InvalidDirective) 
-    {
-        std::cout << std::endl << "*** Error line " << token.line << "." << std::endl
-        << "*** " << token.error.message << std::endl << std::endl; 
-        return;
-    }    
-}
-
-
-void print_tokens(const std::vector<Token>& tokens) {
-    for(Token token: tokens) {
-        if(!token.error.message.empty()) {
-            if(token.error.type != ErrorType::E_UnknownToken) {
-                print_token_error(token);
-                continue;
-            }
-        }  
-        
-        if(token.type != TokenType::T_Unknown) {
-            std::cout << token.text;
-        }
-
-        // Add whitespace padding
-        int padding = 13 - token.text.length(); // 13 based on longest string in string.out
-        if (padding > 0) {
-            std::cout << std::string(padding, ' ');
-        } else {
-            std::cout << ' ';  // Single space if text is longer
-        }
-
-        if(token.type == TokenType::T_Unknown) {
-            std::cout << std::endl << "*** Error line " << token.line << "." << std::endl
-            << "*** Unrecognized char: \'" << token.text << "\'" << std::endl << std::endl;
-            continue;
+    bool testScanner = false;
+    bool flatAST = false; // Print the AST from its flat form
+    bool allErrors = false; // Report every syntax error, not just the first
+    bool loadAST = false; // input_file was written by --saveAST
+    const char* savePath = nullptr; // Where to save the AST, if anywhere
+    const char* cachePath = nullptr; // Parse cache directory, if any
+    bool cacheStats = false; // Print the cache's hit and miss counts
+    bool check = false; // Run the semantic checker instead of printing the AST
+    bool tac = false; // Check, then print three address code instead of the AST
+    for (int k = 2; k < argc; k++) {
+        if (strcmp(argv[k], "--testScanner") == 0) {
+            testScanner = true;
+        } else if (strcmp(argv[k], "--flatAST") == 0) {
+            flatAST = true;
+        } else if (strcmp(argv[k], "--allErrors") == 0) {
+            allErrors = true;
+        } else if (strcmp(argv[k], "--loadAST") == 0) {
+            loadAST = true;
+        } else if (strcmp(argv[k], "--saveAST") == 0 && k + 1 < argc) {
+            savePath = argv[++k];
+        } else if (strcmp(argv[k], "--cache") == 0 && k + 1 < argc) {
+            cachePath = argv[++k];
+        } else if (strcmp(argv[k], "--cacheStats") == 0) {
+            cacheStats = true;
+        } else if (strcmp(argv[k], "--check") == 0) {
+            check = true;
+        } else if (strcmp(argv[k], "--tac") == 0) {
+            tac = true;
         }
-        
-        std::cout << "line " << token.line
-            << " cols " << token.column << "-" << token.column + token.length - 1
-            << " is " << token_to_string(token)
-            << std::endl;
     }
-}
-
-int main(int argc, char* argv[]) {
 
-    if (argc > 3 || argc <= 1) {
-        std::cerr << "Usage: " << argv[0] << " <input_file>" << std::endl;
-        return 1;
+    // A saved AST is printed without scanning or parsing anything
+    if (loadAST) {
+        MappedAST ast;
+        if (!ast.open(argv[1])) {
+            std::cerr << "Failed to load AST from " << argv[1] << std::endl;
+            return 1;
+        }
+        OutputBuffer out;
+        print_flat_ast(ast, out);
+        return 0;
     }
 
-    std::ifstream file(argv[1]);
-    if (!file.is_open()) {
+    SourceFile source;
+    if (!source.open(argv[1])) {
         std::cerr << "Failed to open " << argv[1] << std::endl;
         return 1;
     }
-
-    std::string content;
-    std::string line;
-    std::vector<std::string> sourceCode;
-    while (std::getline(file, line)) {
-        content += line + "\n";
-        sourceCode.push_back(line);
-    }
-    file.close();
     
+    // --saveAST needs the tree, which a cache hit does not build
+    ParseCache cache;
+    if (cachePath && !savePath) {
+        cache.open(cachePath, source);
+    }
+
     Scanner scanner;
-    std::vector<Token> tokens = scanner.tokenize(content);
 
-    if (argv[2] != nullptr) {
-        if (strcmp(argv[2], "--testScanner") == 0) {
-            print_tokens(tokens);
+    if (testScanner) {
+        OutputBuffer out;
+        if (cache.enabled()) {
+            bool hit = cache.replay("tokens", out);
+            cache.record(hit, cacheStats);
+            if (hit) {
+                return 0;
+            }
+        }
+        cache.store("tokens", out, [&](OutputBuffer& entry) {
+            TokenDump(entry).write(scanner.tokenize(source.text()));
+        });
+        return 0;
+    }
+
+    // An input with syntax errors prints them whatever the mode, and how
+    // many depends on --allErrors
+    const char* result = tac ? "tac" : check ? "check" : "ast";
+    const char* errorListing = allErrors ? "allErrors" : "errors";
+    if (cache.enabled()) {
+        OutputBuffer out;
+        bool hit;
+        if (check || tac) {
+            hit = cache.replay(result, out);
+        } else {
+            MappedAST cached;
+            hit = cached.open(cache.entry("ast"));
+            if (hit) {
+                print_flat_ast(cached, out);
+            }
+        }
+        hit = hit || cache.replay(errorListing, out);
+        cache.record(hit, cacheStats);
+        if (hit) {
             return 0;
         }
     }
@@ -114,17 +122,62 @@ int main(int argc, char* argv[]) {
     // }
     // std::cout << std::endl;
 
-    ASTBuilder builder(tokens, sourceCode, false);
-    std::shared_ptr<ASTRootNode> ast;
-
-    try {
-        ast = builder.buildAST();
+    // The parser pulls tokens from the scanner as it goes
+    scanner.start(source.text());
+    TokenStream tokens(scanner);
+    Arena arena; // Every AST node, freed in one go at exit
+    ASTBuilder builder(tokens, source, arena, false);
+    ASTRootNode* ast = builder.buildAST();
+
+    // The reference output stops at the first syntax error
+    if (!builder.syntaxErrors().empty()) {
+        OutputBuffer out;
+        cache.store(errorListing, out, [&](OutputBuffer& entry) {
+            builder.writeErrors(entry, allErrors ? builder.syntaxErrors().size() : 1);
+        });
+        return 0;
     }
-    catch(std::runtime_error exception) {
+
+    if (check || tac) {
+        OutputBuffer out;
+        cache.store(result, out, [&](OutputBuffer& entry) {
+            SemanticChecker checker(source);
+            checker.check(ast);
+            if (check || !checker.semanticErrors().empty()) {
+                checker.writeErrors(entry);
+                return;
+            }
+
+            TACProgram program;
+            generate_tac(ast, program);
+            if (program.mainFunction == TACProgram::NoFunction) {
+                entry.write("\n*** Error.\n*** Linker: function 'main' not defined\n\n");
+                return;
+            }
+            print_tac(program, entry);
+        });
         return 0;
     }
 
-    ast->print(0);
+    if (flatAST || savePath || cache.enabled()) {
+        FlatAST flat(scanner.symbols());
+        flatten_ast(ast, flat);
+        if (savePath && !save_flat_ast(flat, savePath)) {
+            std::cerr << "Failed to save AST to " << savePath << std::endl;
+            return 1;
+        }
+        if (cache.enabled() && save_flat_ast(flat, cache.temporary("ast"))) {
+            cache.commit("ast");
+        }
+        if (flatAST) {
+            OutputBuffer out;
+            print_flat_ast(flat, out);
+            return 0;
+        }
+    }
+
+    OutputBuffer out;
+    ASTPrinter(out).print(ast);
         
     return 0;
 }
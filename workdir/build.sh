@@ -14,7 +14,7 @@ fi
 
 # Compile using g++
 echo "Compiling..."
-g++ -Wall -Wextra -std=c++11 $CPP_FILES -o $OUTPUT
+g++ -Wall -Wextra -std=c++11 -pthread $CPP_FILES -o $OUTPUT
 
 # Check if compilation was successful
 if [ $? -eq 0 ]; then